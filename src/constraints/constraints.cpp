@@ -10,11 +10,14 @@
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 #include <vector>
 
 using namespace taptenc;
 
-clock::clock(::std::string arg_id) : id(arg_id) {}
+clock::clock(Symbol arg_id) : id(arg_id) {}
 
 // Comparison Utils
 
@@ -89,6 +92,8 @@ trueCC::trueCC() { type = CCType::TRUE; }
   return std::make_unique<TrueCC>(TrueCC());
 }
 
+void trueCC::appendAtoms(::std::vector<CCAtom> &) const {}
+
 // UnparsedCC
 unparsedCC::unparsedCC(::std::string cc_string) {
   type = CCType::UNPARSED;
@@ -101,6 +106,14 @@ unparsedCC::unparsedCC(::std::string cc_string) {
   return std::make_unique<UnparsedCC>(UnparsedCC(raw_cc));
 }
 
+void unparsedCC::appendAtoms(::std::vector<CCAtom> &res) const {
+  // empty strings are skipped when printing conjunctions anyways
+  if (raw_cc != "") {
+    res.push_back(
+        CCAtom{CCType::UNPARSED, Symbol(raw_cc), Symbol(), ComparisonOp::EQ, 0});
+  }
+}
+
 // ConjunctionCC
 conjunctionCC::conjunctionCC(const ClockConstraint &first,
                              const ClockConstraint &second) {
@@ -128,6 +141,11 @@ conjunctionCC::conjunctionCC(const ClockConstraint &first,
       ConjunctionCC(*content.first, *content.second));
 }
 
+void conjunctionCC::appendAtoms(::std::vector<CCAtom> &res) const {
+  content.first->appendAtoms(res);
+  content.second->appendAtoms(res);
+}
+
 // ComparisonCC
 comparisonCC::comparisonCC(::std::shared_ptr<Clock> arg_clock,
                            ComparisonOp arg_comp, timepoint arg_constant)
@@ -144,6 +162,11 @@ comparisonCC::comparisonCC(::std::shared_ptr<Clock> arg_clock,
   return clock->id + computils::toString(comp) + std::to_string(constant);
 }
 
+void comparisonCC::appendAtoms(::std::vector<CCAtom> &res) const {
+  res.push_back(
+      CCAtom{CCType::SIMPLE_BOUND, clock->id, Symbol(), comp, constant});
+}
+
 // DifferenceCC
 differenceCC::differenceCC(::std::shared_ptr<Clock> arg_minuend,
                            ::std::shared_ptr<Clock> arg_subtrahend,
@@ -163,6 +186,188 @@ differenceCC::differenceCC(::std::shared_ptr<Clock> arg_minuend,
          computils::toString(comp) + std::to_string(difference);
 }
 
+void DifferenceCC::appendAtoms(::std::vector<CCAtom> &res) const {
+  res.push_back(CCAtom{CCType::DIFFERENCE, minuend->id, subtrahend->id, comp,
+                       difference});
+}
+
+// CCAtom
+bool ccAtom::operator==(const ccAtom &other) const {
+  return type == other.type && lhs == other.lhs && rhs == other.rhs &&
+         comp == other.comp && constant == other.constant;
+}
+
+::std::size_t ccAtom::hash() const {
+  std::size_t res = lhs.hash();
+  res = res * 31 + rhs.hash();
+  res = res * 31 + static_cast<std::size_t>(type);
+  res = res * 31 + static_cast<std::size_t>(comp);
+  res = res * 31 + std::hash<timepoint>{}(constant);
+  return res;
+}
+
+::std::string ccAtom::toString() const {
+  switch (type) {
+  case CCType::SIMPLE_BOUND:
+    return lhs + computils::toString(comp) + std::to_string(constant);
+  case CCType::DIFFERENCE:
+    return lhs + " - " + rhs + computils::toString(comp) +
+           std::to_string(constant);
+  default:
+    return lhs.str();
+  }
+}
+
+// FlatCC
+namespace {
+/**
+ * Global hash-consing store of flat clock constraints.
+ *
+ * The store only observes its entries, an entry removes itself from the store
+ * when the last handle to it is dropped.
+ */
+struct constraintStore {
+  typedef ::std::pair<const FlatCC *, ::std::weak_ptr<const FlatCC>> entry_t;
+  ::std::unordered_multimap<::std::size_t, entry_t> entries;
+  ::std::shared_mutex mutex;
+  /** Index of the next created entry. */
+  ::std::uint64_t next_index = 0;
+};
+
+constraintStore &getStore() {
+  static constraintStore store;
+  return store;
+}
+
+/**
+ * \internal
+ * Entries that are about to be deleted cannot be locked anymore and are
+ * treated as missing, their deleter removes them from the store afterwards.
+ * \endinternal
+ */
+FlatCCPtr findInStore(const constraintStore &store,
+                      const ::std::vector<CCAtom> &atoms, ::std::size_t hash) {
+  auto range = store.entries.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second.first->atoms == atoms) {
+      FlatCCPtr res = it->second.second.lock();
+      if (res) {
+        return res;
+      }
+    }
+  }
+  return nullptr;
+}
+
+void removeFromStore(const FlatCC *entry) {
+  constraintStore &store = getStore();
+  {
+    std::unique_lock<std::shared_mutex> write_lock(store.mutex);
+    auto range = store.entries.equal_range(entry->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.first == entry) {
+        store.entries.erase(it);
+        break;
+      }
+    }
+  }
+  delete entry;
+}
+
+FlatCCPtr internAtoms(::std::vector<CCAtom> &&atoms) {
+  std::size_t hash = atoms.size();
+  for (const auto &atom : atoms) {
+    hash = hash * 131 + atom.hash();
+  }
+  constraintStore &store = getStore();
+  // declared before the locks, so dropping it never deletes an entry while
+  // the store is locked
+  FlatCCPtr res;
+  {
+    std::shared_lock<std::shared_mutex> read_lock(store.mutex);
+    res = findInStore(store, atoms, hash);
+    if (res) {
+      return res;
+    }
+  }
+  std::unique_lock<std::shared_mutex> write_lock(store.mutex);
+  res = findInStore(store, atoms, hash);
+  if (!res) {
+    const FlatCC *entry =
+        new FlatCC(std::move(atoms), hash, store.next_index++);
+    res = FlatCCPtr(entry, removeFromStore);
+    store.entries.emplace(hash, constraintStore::entry_t(entry, res));
+  }
+  return res;
+}
+} // end anonymous namespace
+
+flatCC::flatCC(::std::vector<CCAtom> arg_atoms, ::std::size_t arg_hash,
+               ::std::uint64_t arg_index)
+    : atoms(std::move(arg_atoms)), hash(arg_hash), index(arg_index) {
+  if (atoms.size() == 0) {
+    type = CCType::TRUE;
+  } else if (atoms.size() == 1) {
+    type = atoms[0].type;
+  } else {
+    type = CCType::CONJUNCTION;
+  }
+}
+
+::std::unique_ptr<ClockConstraint> flatCC::createCopy() const {
+  return std::make_unique<FlatCC>(*this);
+}
+
+::std::string flatCC::toString() const {
+  std::string res;
+  for (const auto &atom : atoms) {
+    std::string curr = atom.toString();
+    if (res.size() > 0 && curr.size() > 0) {
+      res += " &amp;&amp; ";
+    }
+    res += curr;
+  }
+  return res;
+}
+
+void flatCC::appendAtoms(::std::vector<CCAtom> &res) const {
+  res.insert(res.end(), atoms.begin(), atoms.end());
+}
+
+FlatCCPtr flatCC::of(const ClockConstraint &cc) {
+  const FlatCC *flat = dynamic_cast<const FlatCC *>(&cc);
+  if (flat != nullptr) {
+    // store entries are owned by shared pointers, copies are not
+    FlatCCPtr res = flat->weak_from_this().lock();
+    if (res) {
+      return res;
+    }
+  }
+  std::vector<CCAtom> atoms;
+  cc.appendAtoms(atoms);
+  return internAtoms(std::move(atoms));
+}
+
+FlatCCPtr flatCC::conjunction(const ClockConstraint &lhs,
+                              const ClockConstraint &rhs) {
+  if (lhs.type == CCType::TRUE) {
+    return FlatCC::of(rhs);
+  }
+  if (rhs.type == CCType::TRUE) {
+    return FlatCC::of(lhs);
+  }
+  std::vector<CCAtom> atoms;
+  lhs.appendAtoms(atoms);
+  rhs.appendAtoms(atoms);
+  return internAtoms(std::move(atoms));
+}
+
+::std::size_t flatCC::storeSize() {
+  constraintStore &store = getStore();
+  std::shared_lock<std::shared_mutex> read_lock(store.mutex);
+  return store.entries.size();
+}
+
 // Bounds
 
 bounds::bounds()
@@ -208,14 +413,14 @@ ConjunctionCC bounds::createConstraintBoundsSat(
   return ConjunctionCC(*below_upper_bound.get(), *lower_bound_reached.get());
 }
 
-bool bounds::operator == (const bounds &other) {
+bool bounds::operator == (const bounds &other) const {
   return this->l_op == other.l_op
          && this->r_op == other.r_op
          && this->lower_bound == other.lower_bound
          && this->upper_bound == other.upper_bound;
 }
 
-bool bounds::operator != (const bounds &other) {
+bool bounds::operator != (const bounds &other) const {
 	return !(*this == other);
 }
 
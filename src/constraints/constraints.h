@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include "../symbol_table.h"
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <memory>
 #include <string>
@@ -23,8 +26,8 @@ using timepoint = int;
  * Clock representation.
  */
 struct clock {
-  std::string id;
-  clock(::std::string arg_id);
+  Symbol id;
+  clock(Symbol arg_id);
 };
 typedef clock Clock;
 
@@ -94,6 +97,8 @@ enum CCType {
   UNPARSED
 };
 
+struct ccAtom;
+
 /**
  * Clock constraint base class. Represents the basic clock constraints of
  * timed automata syntax, but not the extended expressiveness of uppaal.
@@ -114,6 +119,12 @@ struct clockConstraint {
    * Operators &, <, > are replaced by their respective html encodings.
    */
   virtual ::std::string toString() const = 0;
+  /**
+   * Appends the atomic constraints of this constraint to a conjunction.
+   *
+   * @param res flat conjunction to extend
+   */
+  virtual void appendAtoms(::std::vector<ccAtom> &res) const = 0;
 };
 typedef struct clockConstraint ClockConstraint;
 
@@ -121,6 +132,7 @@ typedef struct clockConstraint ClockConstraint;
 struct trueCC : public ClockConstraint {
   ::std::unique_ptr<struct clockConstraint> createCopy() const;
   ::std::string toString() const;
+  void appendAtoms(::std::vector<ccAtom> &res) const;
   trueCC();
 };
 typedef struct trueCC TrueCC;
@@ -136,6 +148,7 @@ struct unparsedCC : public ClockConstraint {
   ::std::string raw_cc;
   ::std::unique_ptr<struct clockConstraint> createCopy() const;
   ::std::string toString() const;
+  void appendAtoms(::std::vector<ccAtom> &res) const;
   unparsedCC(::std::string cc_string);
 };
 typedef struct unparsedCC UnparsedCC;
@@ -151,6 +164,7 @@ struct conjunctionCC : public ClockConstraint {
 
   ::std::unique_ptr<ClockConstraint> createCopy() const;
   ::std::string toString() const;
+  void appendAtoms(::std::vector<ccAtom> &res) const;
 
   /**
    * Creates a new conjunction given two clock constraints.
@@ -186,6 +200,7 @@ struct comparisonCC : public ClockConstraint {
 
   ::std::unique_ptr<ClockConstraint> createCopy() const;
   ::std::string toString() const;
+  void appendAtoms(::std::vector<ccAtom> &res) const;
 };
 typedef struct comparisonCC ComparisonCC;
 
@@ -215,9 +230,89 @@ struct differenceCC : public ClockConstraint {
 
   ::std::unique_ptr<ClockConstraint> createCopy() const;
   ::std::string toString() const;
+  void appendAtoms(::std::vector<ccAtom> &res) const;
 };
 typedef struct differenceCC DifferenceCC;
 
+/**
+ * Atomic constraint, the building block of a FlatCC.
+ *
+ * Clocks are referred to by their (interned) ids.
+ */
+struct ccAtom {
+  /** Either CCType::SIMPLE_BOUND, CCType::DIFFERENCE or CCType::UNPARSED. */
+  CCType type;
+  /**
+   * Compared clock (SIMPLE_BOUND), minuend (DIFFERENCE) or the raw
+   * constraint string (UNPARSED).
+   */
+  Symbol lhs;
+  /** Subtrahend (DIFFERENCE), empty otherwise. */
+  Symbol rhs;
+  ComparisonOp comp;
+  timepoint constant;
+
+  bool operator==(const ccAtom &other) const;
+  ::std::size_t hash() const;
+  ::std::string toString() const;
+};
+typedef struct ccAtom CCAtom;
+
+struct flatCC;
+/** Shared handle to an immutable constraint from the constraint store. */
+typedef ::std::shared_ptr<const struct flatCC> FlatCCPtr;
+
+/**
+ * Immutable, flat conjunction of atomic constraints.
+ *
+ * Instances obtained via FlatCC::of() are hash-consed: structurally equal
+ * constraints (same atoms in the same order) share one instance from a global
+ * store, hence they can be copied by copying the pointer and compared by
+ * comparing pointers. The store is thread safe and only keeps constraints
+ * that are still referenced.
+ *
+ * The type is CCType::TRUE for the empty conjunction, the type of the atom
+ * for a single atom and CCType::CONJUNCTION otherwise.
+ */
+struct flatCC : public ClockConstraint,
+                public ::std::enable_shared_from_this<struct flatCC> {
+  /** Conjuncts in the order they were added. */
+  ::std::vector<CCAtom> atoms;
+  /** Hash over \a atoms. */
+  ::std::size_t hash;
+  /** Position in the order of creation of the store entries. */
+  ::std::uint64_t index;
+
+  ::std::unique_ptr<ClockConstraint> createCopy() const;
+  ::std::string toString() const;
+  void appendAtoms(::std::vector<CCAtom> &res) const;
+
+  /**
+   * Obtains the shared store entry of a constraint.
+   *
+   * @param cc arbitrary constraint, nested conjunctions are flattened
+   * @return shared instance that is structurally equal to \a cc
+   */
+  static FlatCCPtr of(const ClockConstraint &cc);
+
+  /**
+   * Obtains the shared store entry of a conjunction of two constraints.
+   *
+   * @param lhs first conjunct
+   * @param rhs second conjunct
+   * @return shared instance of \a lhs && \a rhs
+   */
+  static FlatCCPtr conjunction(const ClockConstraint &lhs,
+                               const ClockConstraint &rhs);
+
+  /** @return number of distinct constraints currently in use */
+  static ::std::size_t storeSize();
+
+  flatCC(::std::vector<CCAtom> arg_atoms, ::std::size_t arg_hash,
+         ::std::uint64_t arg_index);
+};
+typedef struct flatCC FlatCC;
+
 /**
  * Wrapper to store lower and upper bounds.
  *
@@ -271,8 +366,8 @@ struct bounds {
   ConjunctionCC
   createConstraintBoundsSat(const ::std::shared_ptr<Clock> &clock_ptr) const;
 
-  bool operator == (const bounds &other);
-  bool operator != (const bounds &other);
+  bool operator == (const bounds &other) const;
+  bool operator != (const bounds &other) const;
 };
 typedef struct bounds Bounds;
 
@@ -9,12 +9,14 @@
 #include "enc_interconnection_info.h"
 #include "encoder_utils.h"
 #include "filter.h"
+#include "state_id.h"
 #include "timed_automata.h"
 #include "utils.h"
 #include "vis_info.h"
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -29,38 +31,35 @@ void DirectEncoder::generateBaseTimeLine(AutomataSystem &s,
   std::cout << "DirectEncoder generateBaseTimeLine: Assuming plan automaton "
                "states are sorted by plan order!"
             << std::endl;
-  Filter base_filter = Filter(s.instances[base_index].first.states);
+  // all copies of the platform automaton share it
+  auto base_ta =
+      std::make_shared<const SharedAutomaton>(s.instances[base_index].first);
   for (const auto &pa : s.instances[plan_index].first.states) {
     TimeLine tl;
     std::string ta_prefix = toPrefix("", "", pa.id);
-    Automaton ta_copy = base_filter.filterAutomaton(
-        s.instances[base_index].first, ta_prefix, "", false);
+    TlEntry ta_copy(base_ta, ta_prefix, std::vector<Transition>());
     if (pa.initial) {
-      auto search = std::find_if(ta_copy.states.begin(), ta_copy.states.end(),
-                                 [](const State &s) { return s.initial; });
-      if (search != ta_copy.states.end()) {
-        search->initial = true;
+      auto search =
+          std::find_if(base_ta->ta.states.begin(), base_ta->ta.states.end(),
+                       [](const State &s) { return s.initial; });
+      if (search != base_ta->ta.states.end()) {
         std::cout << "DirectEncoder generateBaseTimeLine: Set initial state: "
-                  << search->id << std::endl;
+                  << ta_copy.stateId(search - base_ta->ta.states.begin())
+                  << std::endl;
       }
     } else {
-      for (auto &s : ta_copy.states) {
-        s.initial = false;
-      }
+      ta_copy.clearInitial();
     }
-    ta_copy.clocks.insert(s.instances[plan_index].first.clocks.begin(),
-                          s.instances[plan_index].first.clocks.end());
-    auto emp_ta = tl.emplace(
-        std::make_pair(ta_prefix, TlEntry(ta_copy, std::vector<Transition>())));
+    ta_copy.clocks |= s.instances[plan_index].first.clocks;
+    auto emp_ta = tl.emplace(std::make_pair(ta_prefix, ta_copy));
     if (emp_ta.second == true) {
-      addInvariants(emp_ta.first->second.ta, emp_ta.first->second.ta.states,
-                    *pa.inv.get());
+      emp_ta.first->second.addInvariant(*pa.inv.get());
     } else {
       std::cout << "DirectEncoder generateBaseTimeLine: plan automaton has non "
                    "unique id (id "
                 << pa.id << ")" << std::endl;
     }
-    po_tls.pa_order.get()->push_back(pa.id);
+    po_tls.addPlanAction(pa.id);
     auto emp_tl = po_tls.tls->emplace(std::make_pair(pa.id, tl));
     if (emp_tl.second == false) {
       std::cout << "DirectEncoder generateBaseTimeLine: plan action timeline "
@@ -85,7 +84,7 @@ void DirectEncoder::generateBaseTimeLine(AutomataSystem &s,
   for (auto &last_tl :
        po_tls.tls->find(s.instances[plan_index].first.states.back().id)
            ->second) {
-    for (auto &s : last_tl.second.ta.states) {
+    for (const auto &s : last_tl.second.states()) {
       last_tl.second.trans_out.push_back(
           Transition(s.id, constants::QUERY, "", TrueCC(), {}, ""));
     }
@@ -97,11 +96,11 @@ void DirectEncoder::generateBaseTimeLine(AutomataSystem &s,
     if (source_ta != po_tls.tls->end() && dest_ta != po_tls.tls->end()) {
       std::string source_ta_prefix = toPrefix("", "", pa_trans.source_id);
       std::string dest_ta_prefix = toPrefix("", "", pa_trans.dest_id);
+      const TlEntry &source_copy =
+          source_ta->second.find(source_ta_prefix)->second;
       std::vector<Transition> copy_trans = createCopyTransitionsBetweenTAs(
-          source_ta->second.find(source_ta_prefix)->second.ta,
-          dest_ta->second.find(dest_ta_prefix)->second.ta,
-          source_ta->second.find(source_ta_prefix)->second.ta.states,
-          *pa_trans.guard.get(), pa_trans.update, "");
+          source_copy, dest_ta->second.find(dest_ta_prefix)->second,
+          source_copy, *pa_trans.guard.get(), pa_trans.update, "");
       po_tls.tls.get()
           ->find(pa_trans.source_id)
           ->second.find(source_ta_prefix)
@@ -118,14 +117,69 @@ void DirectEncoder::generateBaseTimeLine(AutomataSystem &s,
   }
 }
 
+void DirectEncoder::computeDurationSums() {
+  lb_sums.assign(1, 0);
+  ub_sums.assign(1, 0);
+  ub_unbounded.assign(1, 0);
+  for (const auto &pa : plan) {
+    lb_sums.push_back(lb_sums.back() + pa.duration.lower_bound);
+    if (pa.duration.upper_bound == std::numeric_limits<int>::max()) {
+      ub_sums.push_back(ub_sums.back());
+      ub_unbounded.push_back(ub_unbounded.back() + 1);
+    } else {
+      ub_sums.push_back(ub_sums.back() + pa.duration.upper_bound);
+      ub_unbounded.push_back(ub_unbounded.back());
+    }
+  }
+}
+
+long long DirectEncoder::lowerDuration(size_t first, size_t last) const {
+  return lb_sums[last + 1] - lb_sums[first];
+}
+
+long long DirectEncoder::upperDuration(size_t first, size_t last) const {
+  if (ub_unbounded[last + 1] != ub_unbounded[first]) {
+    return std::numeric_limits<int>::max();
+  }
+  return std::min<long long>(ub_sums[last + 1] - ub_sums[first],
+                             std::numeric_limits<int>::max());
+}
+
+namespace {
+/**
+ * Binary search over an index range.
+ *
+ * @param first first index of the range
+ * @param last index past the end of the range
+ * @param pred predicate that is false up to some index and true afterwards
+ * @return first index in [first, last) satisfying \a pred or \a last if
+ *         there is none (\a first if the range is empty)
+ */
+template <class Pred> size_t firstTrue(size_t first, size_t last, Pred pred) {
+  while (first < last) {
+    size_t mid = first + (last - first) / 2;
+    if (pred(mid)) {
+      last = mid;
+    } else {
+      first = mid + 1;
+    }
+  }
+  return first;
+}
+} // end anonymous namespace
+
 std::pair<int, int>
 DirectEncoder::calculateContext(const TargetSpecs &specs,
                                 std::string starting_pa, std::string ending_pa,
                                 bool look_ahead, int lb_offset, int ub_offset) {
+  // Durations are non-negative, so the accumulated bounds only grow with the
+  // window. Hence the windows are found by binary search over prefix sums.
+  long long lb_target = safeAddition(specs.bounds.upper_bound, ub_offset);
+  size_t plan_size = plan.size();
   if (look_ahead) {
     int start_index = 0;
     if (starting_pa != constants::START_PA) {
-      start_index = stoi(Filter::getSuffix(starting_pa, constants::PA_SEP));
+      start_index = StateId::of(starting_pa).pa_index;
     }
     // if an end_index is specified this means the begin of the PA ends the
     // context, hence we have to subtract 1 to exclude the ending pa itself
@@ -134,79 +188,64 @@ DirectEncoder::calculateContext(const TargetSpecs &specs,
       end_index =
           (ending_pa == constants::END_PA)
               ? plan.size() - 1
-              : stoi(Filter::getSuffix(ending_pa, constants::PA_SEP)) - 1;
+              : StateId::of(ending_pa).pa_index - 1;
     }
     if (ending_pa == "" && lb_offset == 0) {
       lb_offset = specs.bounds.lower_bound;
     }
-    int offset_index = start_index;
     if ((long unsigned int)start_index >= plan.size()) {
       std::cout << "DirectEncoder calculateContext: starting pa " << starting_pa
                 << " is out of range" << std::endl;
       return std::make_pair(0, 0);
     }
-    int lb_acc = 0;
-    int ub_acc = 0;
-    for (auto pa = plan.begin() + start_index; pa != plan.end(); ++pa) {
-      lb_acc += pa->duration.lower_bound;
-      if (ub_acc != std::numeric_limits<int>::max()) {
-        // Increase ub_acc only if it does not overflow
-        ub_acc = safeAddition(pa->duration.upper_bound, ub_acc);
-      }
-      if (ub_acc < lb_offset) {
-        offset_index++;
-      }
-      if (lb_acc >= safeAddition(specs.bounds.upper_bound, ub_offset) ||
-          pa - plan.begin() == end_index) {
-        return std::make_pair(offset_index, pa - plan.begin() - offset_index);
-      }
-      if (pa - plan.begin() == end_index) {
-        break;
-      }
+    size_t start = start_index;
+    // the window ends once the lower bounds exceed the constraint or at the
+    // ending pa
+    size_t stop = firstTrue(start, plan_size, [&](size_t i) {
+      return lowerDuration(start, i) >= lb_target;
+    });
+    if (end_index >= start_index && (size_t)end_index < stop) {
+      stop = end_index;
+    }
+    // skip actions that surely end before the lower bound is reached
+    int offset_index = firstTrue(
+        start, std::min(stop + 1, plan_size),
+        [&](size_t i) { return upperDuration(start, i) >= lb_offset; });
+    if (stop == plan_size) {
+      return std::make_pair(offset_index, end_index - offset_index);
     }
-    return std::make_pair(offset_index, end_index - offset_index);
+    return std::make_pair(offset_index, (int)stop - offset_index);
   } else {
-
-    int rstart_index =
-        plan.size() - (std::find(po_tls.pa_order.get()->begin(),
-                                 po_tls.pa_order.get()->end(), starting_pa) -
-                       po_tls.pa_order.get()->begin());
+    std::size_t starting_pos = po_tls.planActionIndex(starting_pa);
+    if (starting_pos == PlanOrderedTLs::npos) {
+      starting_pos = po_tls.pa_order.get()->size();
+    }
+    // positions are counted from the end of the plan
+    size_t rstart = plan_size - starting_pos;
     // if an end_index is specified this means the begin of the PA ends the
     // context, hence we have to subtract 1 to exclude the ending pa itself
     int rend_index =
-        (ending_pa == "")
-            ? plan.size()
-            : plan.size() -
-                  (std::find(po_tls.pa_order.get()->begin(),
-                             po_tls.pa_order.get()->end(), starting_pa) -
-                   po_tls.pa_order.get()->begin()) -
-                  1;
+        (ending_pa == "") ? plan.size() : plan.size() - starting_pos - 1;
     if (ending_pa == "" && lb_offset == 0) {
       lb_offset = specs.bounds.lower_bound;
     }
-    int roffset_index = rstart_index;
-    int lb_acc = 0;
-    int ub_acc = 0;
-    for (auto pa = plan.rbegin() + rstart_index; pa != plan.rend(); ++pa) {
-      lb_acc += pa->duration.lower_bound;
-      if (ub_acc != std::numeric_limits<int>::max()) {
-        // Increase ub_acc only if it does not overflow
-        ub_acc = safeAddition(pa->duration.upper_bound, ub_acc);
-      }
-      if (ub_acc < lb_offset) {
-        roffset_index++;
-      }
-      if (lb_acc >= safeAddition(specs.bounds.upper_bound, ub_offset) ||
-          pa - plan.rbegin() == rend_index) {
-        return std::make_pair(plan.size() - roffset_index,
-                              roffset_index - (pa - plan.rbegin()));
-      }
-      if (pa - plan.rbegin() == rend_index) {
-        break;
-      }
+    size_t stop = firstTrue(rstart, plan_size, [&](size_t r) {
+      return lowerDuration(plan_size - 1 - r, starting_pos - 1) >= lb_target;
+    });
+    if (rend_index >= (int)rstart && (size_t)rend_index < stop) {
+      stop = rend_index;
+    }
+    int roffset_index =
+        firstTrue(rstart, std::min(stop + 1, plan_size), [&](size_t r) {
+          return upperDuration(plan_size - 1 - r, starting_pos - 1) >=
+                 lb_offset;
+        });
+    if (stop >= plan_size) {
+      return std::make_pair(plan_size - roffset_index,
+                            roffset_index - rend_index);
     }
-    return std::make_pair(plan.size() - roffset_index,
-                          roffset_index - rend_index);
+    return std::make_pair(plan_size - roffset_index,
+                          roffset_index - (int)stop);
   }
 }
 
@@ -216,26 +255,24 @@ void DirectEncoder::encodeInvariant(AutomataSystem &,
   Filter target_filter = Filter(targets);
   auto search_tl = po_tls.tls->find(pa);
   if (search_tl != po_tls.tls->end()) {
-    auto search_pa = std::find(po_tls.pa_order.get()->begin(),
-                               po_tls.pa_order.get()->end(), pa);
-    if (search_pa == po_tls.pa_order.get()->end()) {
+    std::size_t pa_index = po_tls.planActionIndex(pa);
+    if (pa_index == PlanOrderedTLs::npos) {
       std::cout << "DirectEncoder encodeInvariant: could not find pa " << pa
                 << std::endl;
       return;
     }
+    recordActivation(pa_index, pa_index);
     // restrict transitions from prev tl to target states
-    if (search_pa - po_tls.pa_order.get()->begin() > 0) {
+    if (pa_index > 0) {
       for (auto &prev_tl_entry :
-           po_tls.tls.get()
-               ->find(po_tls.pa_order.get()->at(
-                   search_pa - po_tls.pa_order.get()->begin() - 1))
+           po_tls.tls.get()->find(po_tls.pa_order.get()->at(pa_index - 1))
                ->second) {
         target_filter.filterTransitionsInPlace(prev_tl_entry.second.trans_out,
                                                pa, false);
       }
     }
     for (auto &tl_entry : search_tl->second) {
-      target_filter.filterAutomatonInPlace(tl_entry.second.ta, "");
+      target_filter.filterEntryInPlace(tl_entry.second);
       target_filter.filterTransitionsInPlace(tl_entry.second.trans_out, pa,
                                              true);
     }
@@ -252,19 +289,17 @@ void DirectEncoder::encodeNoOp(AutomataSystem &,
   Filter target_filter = Filter(targets);
   auto search_tl = po_tls.tls->find(pa);
   if (search_tl != po_tls.tls->end()) {
-    auto search_pa = std::find(po_tls.pa_order.get()->begin(),
-                               po_tls.pa_order.get()->end(), pa);
-    if (search_pa == po_tls.pa_order.get()->end()) {
+    std::size_t pa_index = po_tls.planActionIndex(pa);
+    if (pa_index == PlanOrderedTLs::npos) {
       std::cout << "DirectEncoder encodeNoOp: could not find pa " << pa
                 << std::endl;
       return;
     }
+    recordActivation(pa_index, pa_index);
     // restrict transitions from prev tl to target states
-    if (search_pa - po_tls.pa_order.get()->begin() > 0) {
+    if (pa_index > 0) {
       for (auto &prev_tl_entry :
-           po_tls.tls.get()
-               ->find(po_tls.pa_order.get()->at(
-                   search_pa - po_tls.pa_order.get()->begin() - 1))
+           po_tls.tls.get()->find(po_tls.pa_order.get()->at(pa_index - 1))
                ->second) {
         target_filter.filterTransitionsInPlace(prev_tl_entry.second.trans_out,
                                                pa, false);
@@ -288,16 +323,14 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
   std::string clock = "clX" + info.name;
   std::shared_ptr<Clock> clock_ptr =
       encoderutils::addClock(s.globals.clocks, clock);
-  auto start_pa_entry = std::find(po_tls.pa_order.get()->begin(),
-                                  po_tls.pa_order.get()->end(), start_pa);
-  if (start_pa_entry == po_tls.pa_order.get()->end()) {
+  std::size_t start_pa_index = po_tls.planActionIndex(start_pa);
+  if (start_pa_index == PlanOrderedTLs::npos) {
     std::cout << "DirectEncoder encodeUntilChain: could not find start pa "
               << start_pa << std::endl;
     return;
   }
-  auto end_pa_entry =
-      std::find(start_pa_entry, po_tls.pa_order.get()->end(), end_pa);
-  if (end_pa_entry == po_tls.pa_order.get()->end()) {
+  std::size_t end_pa_index = po_tls.planActionIndex(end_pa);
+  if (end_pa_index == PlanOrderedTLs::npos || end_pa_index < start_pa_index) {
     std::cout << "DirectEncoder encodeUntilChain: could not find end pa "
               << end_pa << std::endl;
     return;
@@ -315,9 +348,9 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
     curr_window.tls.get()->emplace(tl);
   }
   for (const auto &pa : *(po_tls.pa_order.get())) {
-    orig_tls.pa_order.get()->push_back(pa);
-    curr_window.pa_order.get()->push_back(pa);
-    prev_window.pa_order.get()->push_back(pa);
+    orig_tls.addPlanAction(pa);
+    curr_window.addPlanAction(pa);
+    prev_window.addPlanAction(pa);
   }
 
   // maps to obtain the original tl entry id given the prefix of
@@ -325,14 +358,12 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
   OrigMap prev_to_orig;
   OrigMap curr_to_orig;
   // delete all tls form the until chain
-  for (auto window_pa = start_pa_entry;
-       window_pa - po_tls.pa_order.get()->begin() <
-       end_pa_entry - po_tls.pa_order.get()->begin();
-       ++window_pa) {
-    po_tls.tls.get()->find(*window_pa)->second.clear();
+  for (std::size_t i = start_pa_index; i < end_pa_index; i++) {
+    po_tls.tls.get()->find(po_tls.pa_order.get()->at(i))->second.clear();
   }
   if (end_pa == constants::END_PA) {
-    po_tls.tls.get()->find(*end_pa_entry)->second.clear();
+    po_tls.tls.get()->find(po_tls.pa_order.get()->at(end_pa_index))
+        ->second.clear();
   }
   // init curr_to_orig
   for (const auto &pa_tl : *(orig_tls.tls.get())) {
@@ -363,10 +394,6 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
     // std::cout << "until chain context " << context_start << "," <<
     // context_end
     //           << std::endl;
-    std::string context_pa_start =
-        *(po_tls.pa_order.get()->begin() + context_start);
-    std::string context_pa_end =
-        *(po_tls.pa_order.get()->begin() + context_end);
     // formulate constraints based on the given bounds
     TrueCC prev_window_guard_constraint_sat = TrueCC();
     bool upper_bounded =
@@ -376,14 +403,14 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
         specs->bounds.upper_bound);
     ConjunctionCC guard_constraint_sat =
         specs->bounds.createConstraintBoundsSat(clock_ptr);
-    std::string op_name = info.name + "F" + std::to_string(encode_counter);
-    encode_counter++;
+    std::string op_name = windowName(info.name, start_pa_index,
+                                     specs - info.specs_list.begin());
     Filter target_filter(specs->targets);
-    curr_window = orig_tls.createWindow(context_pa_start, context_pa_end,
+    curr_window = orig_tls.createWindow(context_start, context_end,
                                         target_filter, op_name);
     if (upper_bounded) {
       curr_window.addStateInvariantToWindow(
-          context_pa_start, context_pa_end,
+          context_start, context_end,
           ComparisonCC(clock_ptr, specs->bounds.r_op,
                        specs->bounds.upper_bound));
     }
@@ -394,8 +421,8 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
             *(po_tls.pa_order.get()->begin() + context_start - 1);
         for (auto &prev_pa_entry : po_tls.tls.get()->find(prev_pa)->second) {
           PlanOrderedTLs::modifyTransitionsToNextTl(
-              prev_pa_entry.second.trans_out, prev_pa,
-              target_filter.getFilter(), TrueCC(), {clock_ptr}, "", op_name);
+              prev_pa_entry.second.trans_out, prev_pa, target_filter, TrueCC(),
+              {clock_ptr}, "", op_name);
         }
       }
     }
@@ -409,7 +436,7 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
     }
     prev_window.createTransitionsToWindow(
         s.instances[base_index].first, *(curr_window.tls.get()), to_orig,
-        context_pa_start, context_pa_end, base_filter,
+        context_start, context_end, base_filter,
         prev_window_guard_constraint_sat, {clock_ptr},
         add_succ_trans || prev_add_succ_trans);
     // add transitions back to original TLs
@@ -428,15 +455,16 @@ void DirectEncoder::encodeUntilChain(AutomataSystem &s, const ChainInfo &info,
   }
   // merge the last window
   po_tls.mergeWindow(*(curr_window.tls.get()), true);
+  // all windows of the chain lie between start and end pa
+  recordActivation(start_pa_index, end_pa_index, clock_ptr);
 }
 
 void DirectEncoder::encodeFuture(AutomataSystem &s, const std::string pa,
                                  const UnaryInfo &info, int base_index,
                                  bool add_succ_trans) {
   Filter base_filter = Filter(s.instances[base_index].first.states);
-  auto start_pa_entry = std::find(po_tls.pa_order.get()->begin(),
-                                  po_tls.pa_order.get()->end(), pa);
-  if (start_pa_entry == po_tls.pa_order.get()->end()) {
+  std::size_t start_pa_index = po_tls.planActionIndex(pa);
+  if (start_pa_index == PlanOrderedTLs::npos) {
     std::cout << "DirectEncoder encodeFuture: could not find start pa " << pa
               << std::endl;
     return;
@@ -447,7 +475,7 @@ void DirectEncoder::encodeFuture(AutomataSystem &s, const std::string pa,
     curr_window.tls.get()->emplace(tl);
   }
   for (const auto &pa : *(po_tls.pa_order.get())) {
-    curr_window.pa_order.get()->push_back(pa);
+    curr_window.addPlanAction(pa);
   }
   // maps to obtain the original tl entry id given the prefix of
   // new window prefix id
@@ -457,14 +485,11 @@ void DirectEncoder::encodeFuture(AutomataSystem &s, const std::string pa,
   // determine context (window begin and end)
   std::pair<int, int> context = calculateContext(info.specs, pa, "");
   std::size_t context_start = context.first;
-  std::size_t constraint_start =
-      start_pa_entry - po_tls.pa_order.get()->begin();
+  std::size_t constraint_start = start_pa_index;
   std::size_t context_end = context.first + context.second;
+  recordActivation(constraint_start, context_end, clock_ptr);
   // std::cout << "context: " << context_start << "," << context_end <<
   // std::endl;
-  std::string context_pa_start =
-      *(po_tls.pa_order.get()->begin() + context_start);
-  std::string context_pa_end = *(po_tls.pa_order.get()->begin() + context_end);
   // formulate constraints based on the given bounds
   bool upper_bounded =
       (info.specs.bounds.upper_bound != std::numeric_limits<int>::max());
@@ -473,18 +498,18 @@ void DirectEncoder::encodeFuture(AutomataSystem &s, const std::string pa,
       info.specs.bounds.upper_bound);
   ConjunctionCC guard_constraint_sat =
       info.specs.bounds.createConstraintBoundsSat(clock_ptr);
-  std::string op_name = info.name + "F" + std::to_string(encode_counter);
+  std::string op_name = windowName(info.name, start_pa_index);
   Filter target_filter(info.specs.targets);
-  curr_window = po_tls.createWindow(context_pa_start, context_pa_end,
-                                    base_filter, op_name);
+  curr_window =
+      po_tls.createWindow(context_start, context_end, base_filter, op_name);
   // creset clock upon entering context range
   if (constraint_start > 0) {
     std::string prev_pa =
         *(po_tls.pa_order.get()->begin() + constraint_start - 1);
     for (auto &prev_pa_entry : po_tls.tls.get()->find(prev_pa)->second) {
       PlanOrderedTLs::modifyTransitionsToNextTl(
-          prev_pa_entry.second.trans_out, prev_pa, base_filter.getFilter(),
-          TrueCC(), {clock_ptr}, "");
+          prev_pa_entry.second.trans_out, prev_pa, base_filter, TrueCC(),
+          {clock_ptr}, "");
     }
   }
   OrigMap orig_id = po_tls.createOrigMapping("");
@@ -492,13 +517,13 @@ void DirectEncoder::encodeFuture(AutomataSystem &s, const std::string pa,
   to_orig.insert(orig_id.begin(), orig_id.end());
   if (upper_bounded) {
     po_tls.addStateInvariantToWindow(
-        context_pa_start, context_pa_end,
+        context_start, context_end,
         ComparisonCC(clock_ptr, info.specs.bounds.r_op,
                      info.specs.bounds.upper_bound));
   }
   po_tls.createTransitionsToWindow(
       s.instances[base_index].first, *(curr_window.tls.get()), to_orig,
-      context_pa_start, context_pa_end, target_filter, guard_constraint_sat, {},
+      context_start, context_end, target_filter, guard_constraint_sat, {},
       add_succ_trans);
   std::string last_pa = *(po_tls.pa_order.get()->begin() + context_end);
   PlanOrderedTLs::addOutgoingTransOfOrigTL(
@@ -513,9 +538,8 @@ void DirectEncoder::encodeFuture(AutomataSystem &s, const std::string pa,
 
 void DirectEncoder::encodeUntil(AutomataSystem &s, const std::string pa,
                                 const BinaryInfo &info, int base_index) {
-  auto start_pa_entry = std::find(po_tls.pa_order.get()->begin(),
-                                  po_tls.pa_order.get()->end(), pa);
-  if (start_pa_entry == po_tls.pa_order.get()->end()) {
+  std::size_t start_pa_index = po_tls.planActionIndex(pa);
+  if (start_pa_index == PlanOrderedTLs::npos) {
     std::cout << "DirectEncoder encodeUntil: could not find start pa " << pa
               << std::endl;
     return;
@@ -526,15 +550,15 @@ void DirectEncoder::encodeUntil(AutomataSystem &s, const std::string pa,
   // determine context (window begin and end)
   std::pair<int, int> context = calculateContext(info.specs, pa, "", true);
   std::size_t context_end = context.first + context.second;
-  std::size_t constraint_start =
-      start_pa_entry - po_tls.pa_order.get()->begin();
+  std::size_t constraint_start = start_pa_index;
+  recordActivation(constraint_start, context_end);
   encodeFuture(s, pa, info.toUnary(), base_index, true);
   for (size_t i = constraint_start; i <= context_end; i++) {
     auto pa_tl = po_tls.tls->find(*(po_tls.pa_order.get()->begin() + i));
     if (pa_tl != po_tls.tls->end()) {
       for (auto &tl_entry : pa_tl->second) {
         if (to_orig[tl_entry.first] != "") {
-          pre_target_filter.filterAutomatonInPlace(tl_entry.second.ta, "");
+          pre_target_filter.filterEntryInPlace(tl_entry.second);
           pre_target_filter.filterTransitionsInPlace(tl_entry.second.trans_out,
                                                      "", true);
         }
@@ -561,9 +585,8 @@ void DirectEncoder::encodePast(AutomataSystem &s, const std::string pa,
                                const UnaryInfo &info, int base_index,
                                bool add_succ_trans) {
   Filter base_filter = Filter(s.instances[base_index].first.states);
-  auto start_pa_entry = std::find(po_tls.pa_order.get()->begin(),
-                                  po_tls.pa_order.get()->end(), pa);
-  if (start_pa_entry == po_tls.pa_order.get()->end()) {
+  std::size_t start_pa_index = po_tls.planActionIndex(pa);
+  if (start_pa_index == PlanOrderedTLs::npos) {
     std::cout << "DirectEncoder encodePast: could not find start pa " << pa
               << std::endl;
     return;
@@ -574,7 +597,7 @@ void DirectEncoder::encodePast(AutomataSystem &s, const std::string pa,
     curr_window.tls.get()->emplace(tl);
   }
   for (const auto &pa : *(po_tls.pa_order.get())) {
-    curr_window.pa_order.get()->push_back(pa);
+    curr_window.addPlanAction(pa);
   }
   // maps to obtain the original tl entry id given the prefix of
   // new window prefix id
@@ -584,14 +607,11 @@ void DirectEncoder::encodePast(AutomataSystem &s, const std::string pa,
   // determine context (window begin and end)
   std::pair<int, int> context = calculateContext(info.specs, pa, "", false);
   std::size_t context_end = context.first;
-  std::size_t constraint_end =
-      start_pa_entry - po_tls.pa_order.get()->begin() - 1;
+  std::size_t constraint_end = start_pa_index - 1;
   std::size_t context_start = context.first + context.second;
-  std::string context_pa_start =
-      *(po_tls.pa_order.get()->begin() + context_start);
-  std::string context_pa_end = *(po_tls.pa_order.get()->begin() + context_end);
   std::string constraint_end_pa =
       *(po_tls.pa_order.get()->begin() + constraint_end);
+  recordActivation(context_start, start_pa_index, clock_ptr);
   // formulate constraints based on the given bounds
   bool lower_bounded = (info.specs.bounds.lower_bound == 0 &&
                         info.specs.bounds.l_op == ComparisonOp::LTE);
@@ -602,26 +622,24 @@ void DirectEncoder::encodePast(AutomataSystem &s, const std::string pa,
       info.specs.bounds.upper_bound);
   ConjunctionCC guard_constraint_sat =
       info.specs.bounds.createConstraintBoundsSat(clock_ptr);
-  std::string op_name = info.name + "F" + std::to_string(encode_counter);
+  std::string op_name = windowName(info.name, start_pa_index);
   Filter target_filter(info.specs.targets);
-  curr_window = po_tls.createWindow(context_pa_start, context_pa_end,
-                                    base_filter, op_name);
+  curr_window =
+      po_tls.createWindow(context_start, context_end, base_filter, op_name);
   OrigMap orig_id = po_tls.createOrigMapping("");
   OrigMap to_orig = po_tls.createOrigMapping(op_name);
   to_orig.insert(orig_id.begin(), orig_id.end());
   if (upper_bounded) {
     if (context_end < constraint_end) {
-      std::string past_context_pa =
-          *(po_tls.pa_order.get()->begin() + context_end + 1);
       po_tls.addStateInvariantToWindow(
-          past_context_pa, constraint_end_pa,
+          context_end + 1, constraint_end,
           ComparisonCC(clock_ptr, info.specs.bounds.r_op,
                        info.specs.bounds.upper_bound));
     }
   }
   po_tls.createTransitionsToWindow(
       s.instances[base_index].first, *(curr_window.tls.get()), to_orig,
-      context_pa_start, context_pa_end, target_filter, TrueCC(), {clock_ptr},
+      context_start, context_end, target_filter, TrueCC(), {clock_ptr},
       add_succ_trans);
   std::string last_pa = *(po_tls.pa_order.get()->begin() + context_end);
   PlanOrderedTLs::addOutgoingTransOfOrigTL(
@@ -640,8 +658,8 @@ void DirectEncoder::encodePast(AutomataSystem &s, const std::string pa,
     }
     for (auto &last_entry : *last_tl) {
       PlanOrderedTLs::modifyTransitionsToNextTl(
-          last_entry.second.trans_out, constraint_end_pa,
-          target_filter.getFilter(), guard_constraint_sat, {}, "");
+          last_entry.second.trans_out, constraint_end_pa, target_filter,
+          guard_constraint_sat, {}, "");
     }
   }
   po_tls.mergeWindow(*(curr_window.tls.get()), true);
@@ -649,9 +667,8 @@ void DirectEncoder::encodePast(AutomataSystem &s, const std::string pa,
 
 void DirectEncoder::encodeSince(AutomataSystem &s, const std::string pa,
                                 const BinaryInfo &info, int base_index) {
-  auto start_pa_entry = std::find(po_tls.pa_order.get()->begin(),
-                                  po_tls.pa_order.get()->end(), pa);
-  if (start_pa_entry == po_tls.pa_order.get()->end()) {
+  std::size_t start_pa_index = po_tls.planActionIndex(pa);
+  if (start_pa_index == PlanOrderedTLs::npos) {
     std::cout << "DirectEncoder encodeSince: could not find start pa " << pa
               << std::endl;
     return;
@@ -663,8 +680,8 @@ void DirectEncoder::encodeSince(AutomataSystem &s, const std::string pa,
   std::pair<int, int> context = calculateContext(info.specs, pa, "", false);
   std::size_t context_start = context.first + context.second;
   std::size_t context_end = context.first;
-  std::size_t constraint_end =
-      start_pa_entry - po_tls.pa_order.get()->begin() - 1;
+  std::size_t constraint_end = start_pa_index - 1;
+  recordActivation(context_start, start_pa_index);
   encodePast(s, pa, info.toUnary(), base_index, true);
   // Ensure the TA stays in the pre_target state until activation pa is reached
   for (size_t i = context_start; i <= constraint_end; i++) {
@@ -676,7 +693,7 @@ void DirectEncoder::encodeSince(AutomataSystem &s, const std::string pa,
         // should stay in the pre_target states
         if (i <= context_end) {
           if (to_orig.find(tl_entry.first) == to_orig.end()) {
-            pre_target_filter.filterAutomatonInPlace(tl_entry.second.ta, "");
+            pre_target_filter.filterEntryInPlace(tl_entry.second);
             pre_target_filter.filterTransitionsInPlace(
                 tl_entry.second.trans_out, "", true);
           } else {
@@ -686,9 +703,8 @@ void DirectEncoder::encodeSince(AutomataSystem &s, const std::string pa,
                 std::remove_if(
                     tl_entry.second.trans_out.begin(),
                     tl_entry.second.trans_out.end(),
-                    [to_orig, pre_target_filter, this](const Transition &t) {
-                      std::string prefix =
-                          Filter::getPrefix(t.dest_id, constants::BASE_SEP);
+                    [&to_orig, &pre_target_filter](const Transition &t) {
+                      std::string prefix = StateId::of(t.dest_id).timeline;
                       prefix.push_back(constants::BASE_SEP);
                       return (to_orig.find(prefix) == to_orig.end()) &&
                              !pre_target_filter.matchesId(t.dest_id);
@@ -699,7 +715,7 @@ void DirectEncoder::encodeSince(AutomataSystem &s, const std::string pa,
           // remain in the pre_target states
         } else if (to_orig.find(tl_entry.first) != to_orig.end() &&
                    i > context_end) {
-          pre_target_filter.filterAutomatonInPlace(tl_entry.second.ta, "");
+          pre_target_filter.filterEntryInPlace(tl_entry.second);
           pre_target_filter.filterTransitionsInPlace(tl_entry.second.trans_out,
                                                      "", true);
         }
@@ -723,86 +739,187 @@ void DirectEncoder::encodeSince(AutomataSystem &s, const std::string pa,
 
 size_t DirectEncoder::getPlanTAIndex() { return plan_ta_index; }
 
-AutomataSystem DirectEncoder::createFinalSystem(const AutomataSystem &s,
-                                                SystemVisInfo &s_vis) {
+void DirectEncoder::recordActivation(size_t first, size_t last,
+                                     std::shared_ptr<Clock> clock) {
+  activations.push_back(
+      EncodedActivation{first > 0 ? first - 1 : 0, last, clock});
+}
+
+std::string DirectEncoder::windowName(const std::string &constraint,
+                                      size_t pa_index, size_t chain_pos) {
+  std::string res = constraint + "F" + std::to_string(pa_index);
+  if (chain_pos != npos_chain) {
+    res += "F" + std::to_string(chain_pos);
+  }
+  return res;
+}
+
+/**
+ * \internal
+ * Timeline i holds the invariant of plan action i + 1 and the transitions
+ * guarded by it, so only the timelines before the last shared plan action
+ * are independent from the changed part of the plan.
+ * Then the bound is lowered until no encoded constraint spans over it,
+ * because such a constraint has to be encoded again.
+ * \endinternal
+ */
+size_t DirectEncoder::reusableTimelines(const std::vector<PlanAction> &new_plan,
+                                        size_t limit) const {
+  if (new_plan.empty() || plan.empty()) {
+    return 0;
+  }
+  // compare the plans including the start action
+  size_t shared = 0;
+  Bounds new_start(0, new_plan.front().absolute_time.lower_bound,
+                   ComparisonOp::LTE, new_plan.front().absolute_time.l_op);
+  if (plan.front().absolute_time == new_start) {
+    shared++;
+    while (shared < plan.size() && shared - 1 < new_plan.size()) {
+      const PlanAction &old_pa = plan[shared];
+      const PlanAction &new_pa = new_plan[shared - 1];
+      if (old_pa.name.toString() != new_pa.name.toString() ||
+          old_pa.absolute_time != new_pa.absolute_time ||
+          old_pa.duration != new_pa.duration) {
+        break;
+      }
+      shared++;
+    }
+  }
+  size_t res = std::min(shared > 0 ? shared - 1 : 0, limit);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto &act : activations) {
+      if (act.first < res && act.last >= res) {
+        res = act.first;
+        changed = true;
+      }
+    }
+  }
+  return res;
+}
+
+AutomataSystem DirectEncoder::createFinalSystem(const AutomataSystem &s) {
+  // index all timeline entries and the states they contain
+  std::vector<TlEntry *> entries;
+  std::vector<Symbol> entry_tl;
+  std::vector<Symbol> entry_names;
+  std::unordered_multimap<Symbol, size_t> state_entries;
+  for (auto &curr_tl : *(po_tls.tls.get())) {
+    for (auto &curr_copy : curr_tl.second) {
+      for (size_t i = 0; i < curr_copy.second.sharedSize(); i++) {
+        if (curr_copy.second.isActive(i)) {
+          state_entries.emplace(curr_copy.second.stateId(i), entries.size());
+        }
+      }
+      entries.push_back(&curr_copy.second);
+      entry_tl.push_back(curr_tl.first);
+      entry_names.push_back(curr_copy.first);
+    }
+  }
   // Check if all outgoing transitions actually connect existing states
   // Currently in rare cases a transition is not cleaned up properly during
   // encoding, if the endpoints are manipulated.
-  for (auto curr_pa = po_tls.pa_order.get()->begin();
-       curr_pa != po_tls.pa_order.get()->end(); ++curr_pa) {
-    for (auto &tl : (*po_tls.tls.get())[*curr_pa]) {
-      std::vector<Transition> pruned_trans_out;
-      for (auto &trans : tl.second.trans_out) {
-        auto find_source = std::find_if(
-            tl.second.ta.states.begin(), tl.second.ta.states.end(),
-            [trans](const State &s) { return s.id == trans.source_id; });
-        if (find_source == tl.second.ta.states.end()) {
-          continue;
-        }
-        bool dest_found = false;
-        for (const auto &search_tl : (*po_tls.tls.get())[Filter::getPrefix(
-                 trans.dest_id, constants::TL_SEP)]) {
-          auto find_dest = std::find_if(
-              search_tl.second.ta.states.begin(),
-              search_tl.second.ta.states.end(),
-              [trans](const State &s) { return s.id == trans.dest_id; });
-          if (find_dest != search_tl.second.ta.states.end()) {
-            dest_found = true;
-            break;
-          }
-        }
-        if (!dest_found) {
-          continue;
-        } else {
-          pruned_trans_out.push_back(trans);
-        }
-      }
-      tl.second.trans_out = pruned_trans_out;
+  for (const auto &pa : *(po_tls.pa_order.get())) {
+    auto curr_tl = po_tls.tls.get()->find(pa);
+    if (curr_tl == po_tls.tls.get()->end()) {
+      continue;
+    }
+    for (auto &tl : curr_tl->second) {
+      auto &trans_out = tl.second.trans_out;
+      trans_out.erase(
+          std::remove_if(
+              trans_out.begin(), trans_out.end(),
+              [&](const Transition &trans) {
+                if (!tl.second.containsState(trans.source_id)) {
+                  return true;
+                }
+                const Symbol &dest_pa = StateId::of(trans.dest_id).plan_action;
+                auto dest_entries = state_entries.equal_range(trans.dest_id);
+                return std::none_of(dest_entries.first, dest_entries.second,
+                                    [&](const auto &dest_entry) {
+                                      return entry_tl[dest_entry.second] ==
+                                             dest_pa;
+                                    });
+              }),
+          trans_out.end());
     }
   }
-  s_vis = SystemVisInfo(*(po_tls.tls.get()), *(po_tls.pa_order.get()));
   AutomataSystem res = s;
   res.instances.clear();
-  std::vector<State> last_pruned_states;
-  std::unordered_set<std::string> already_pruned;
-  // prune deadend TLEntries by deleting all transitions to them
-  do {
-    Filter curr_filter(last_pruned_states, true);
-    last_pruned_states.clear();
-    for (auto &curr_tl : *(po_tls.tls.get())) {
-      for (auto &curr_copy : curr_tl.second) {
-        curr_filter.filterTransitionsInPlace(curr_copy.second.trans_out, "",
-                                             false);
-        if (curr_copy.first == constants::QUERY ||
-            curr_copy.second.trans_out.size() > 0) {
-        } else if (already_pruned.find(curr_copy.first) ==
-                   already_pruned.end()) {
-          last_pruned_states.insert(last_pruned_states.end(),
-                                    curr_copy.second.ta.states.begin(),
-                                    curr_copy.second.ta.states.end());
-          already_pruned.insert(curr_copy.first);
-          // std::cout << "DirectEncoder createFinalSystem: pruned "
-          //           << curr_copy.first << std::endl;
-        }
+  // prune deadend TLEntries by deleting all transitions to them,
+  // predecessors of pruned entries are found via reverse edges
+  std::vector<size_t> trans_offsets(entries.size() + 1, 0);
+  for (size_t i = 0; i < entries.size(); i++) {
+    trans_offsets[i + 1] = trans_offsets[i] + entries[i]->trans_out.size();
+  }
+  std::vector<size_t> trans_owner(trans_offsets.back());
+  std::vector<std::vector<size_t>> incoming(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    for (size_t j = 0; j < entries[i]->trans_out.size(); j++) {
+      trans_owner[trans_offsets[i] + j] = i;
+      auto dest_entries =
+          state_entries.equal_range(entries[i]->trans_out[j].dest_id);
+      for (auto it = dest_entries.first; it != dest_entries.second; ++it) {
+        incoming[it->second].push_back(trans_offsets[i] + j);
+      }
+    }
+  }
+  std::vector<bool> pruned_trans(trans_offsets.back(), false);
+  std::vector<size_t> num_trans_out(entries.size());
+  std::vector<size_t> worklist;
+  for (size_t i = 0; i < entries.size(); i++) {
+    num_trans_out[i] = entries[i]->trans_out.size();
+    if (num_trans_out[i] == 0 && entry_names[i] != constants::QUERY) {
+      worklist.push_back(i);
+    }
+  }
+  while (!worklist.empty()) {
+    size_t pruned = worklist.back();
+    worklist.pop_back();
+    for (size_t trans_pos : incoming[pruned]) {
+      if (pruned_trans[trans_pos]) {
+        continue;
+      }
+      pruned_trans[trans_pos] = true;
+      size_t pred = trans_owner[trans_pos];
+      if (--num_trans_out[pred] == 0 &&
+          entry_names[pred] != constants::QUERY) {
+        worklist.push_back(pred);
+      }
+    }
+  }
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (num_trans_out[i] == entries[i]->trans_out.size()) {
+      continue;
+    }
+    std::vector<Transition> kept_trans_out;
+    kept_trans_out.reserve(num_trans_out[i]);
+    for (size_t j = 0; j < entries[i]->trans_out.size(); j++) {
+      if (!pruned_trans[trans_offsets[i] + j]) {
+        kept_trans_out.push_back(std::move(entries[i]->trans_out[j]));
       }
     }
-  } while (last_pruned_states.size() > 0);
+    entries[i]->trans_out = std::move(kept_trans_out);
+  }
   // merge together the rest
-  std::vector<Automaton> automata;
+  std::vector<const TlEntry *> copies;
   std::vector<Transition> interconnections;
   for (const auto &curr_tl : *(po_tls.tls.get())) {
     for (const auto &curr_copy : curr_tl.second) {
       if (curr_copy.first == constants::QUERY ||
           curr_copy.second.trans_out.size() > 0) {
-        automata.push_back(curr_copy.second.ta);
+        copies.push_back(&curr_copy.second);
         interconnections.insert(interconnections.end(),
                                 curr_copy.second.trans_out.begin(),
                                 curr_copy.second.trans_out.end());
       }
     }
   }
+  Automaton direct_ta = mergeAutomata(copies, interconnections, "direct");
+  // states that are not on a path to the query never occur in a trace
   res.instances.push_back(
-      std::make_pair(mergeAutomata(automata, interconnections, "direct"), ""));
+      std::make_pair(sliceAutomaton(direct_ta, constants::QUERY), ""));
   return res;
 }
 /**
@@ -824,11 +941,163 @@ DirectEncoder::DirectEncoder(AutomataSystem &s,
                  Bounds(0, plan.front().absolute_time.lower_bound,
                         ComparisonOp::LTE, plan.front().absolute_time.l_op),
                  Bounds(0, std::numeric_limits<int>::max())));
+  computeDurationSums();
   s.instances.push_back(std::make_pair(plan_ta, ""));
   plan_ta_index = s.instances.size() - 1;
   generateBaseTimeLine(s, base_pos, plan_ta_index);
 }
 
+EncodingEstimate DirectEncoder::estimateBase(const Automaton &platform) const {
+  return EncodingEstimate(po_tls.pa_order->size(), platform);
+}
+
+EncodingEstimate DirectEncoder::measure() const {
+  EncodingEstimate res;
+  for (const auto &pa : *po_tls.pa_order) {
+    double num_states = 0;
+    double num_transitions = 0;
+    double num_outgoing = 0;
+    auto tl = po_tls.tls->find(pa);
+    if (tl != po_tls.tls->end()) {
+      for (const auto &entry : tl->second) {
+        num_states += entry.second.numStates();
+        num_transitions += entry.second.numTransitions();
+        num_outgoing += entry.second.trans_out.size();
+      }
+    }
+    res.states.push_back(num_states);
+    res.transitions.push_back(num_transitions);
+    res.outgoing.push_back(num_outgoing);
+  }
+  return res;
+}
+
+namespace {
+/**
+ * @param targets target states of a constraint
+ * @param platform platform TA the targets belong to
+ * @return fraction of the platform states that are targets
+ */
+double targetFraction(const std::vector<State> &targets,
+                      const Automaton &platform) {
+  if (platform.states.empty()) {
+    return 1;
+  }
+  return std::min(1.0, (double)targets.size() / platform.states.size());
+}
+} // end anonymous namespace
+
+/**
+ * \internal
+ * Mirrors the windows that the encode functions create and the filters they
+ * apply to the timeline copies.
+ * \endinternal
+ */
+void DirectEncoder::estimateActivation(EncodingEstimate &est,
+                                       const Automaton &platform,
+                                       const EncICInfo &info,
+                                       const std::string &pa,
+                                       const std::string &end_pa) {
+  std::size_t pa_index = po_tls.planActionIndex(pa);
+  if (pa_index == PlanOrderedTLs::npos) {
+    std::cout << "DirectEncoder estimateActivation: could not find pa " << pa
+              << std::endl;
+    return;
+  }
+  switch (info.type) {
+  case ICType::Future:
+  case ICType::Past: {
+    const UnaryInfo &unary = dynamic_cast<const UnaryInfo &>(info);
+    std::pair<int, int> context =
+        calculateContext(unary.specs, pa, "", info.isFutureInfo());
+    // look-behind windows are returned from their end
+    est.addWindow(est, std::min(context.first, context.first + context.second),
+                  std::max(context.first, context.first + context.second));
+  } break;
+  case ICType::Until: {
+    const BinaryInfo &binary = dynamic_cast<const BinaryInfo &>(info);
+    std::pair<int, int> context = calculateContext(binary.specs, pa, "", true);
+    size_t context_end = context.first + context.second;
+    EncodingEstimate orig = est;
+    // the original timelines stay in the pre targets
+    est.restrict(pa_index, context_end,
+                 targetFraction(binary.pre_targets, platform));
+    est.addWindow(orig, context.first, context_end);
+  } break;
+  case ICType::Since: {
+    const BinaryInfo &binary = dynamic_cast<const BinaryInfo &>(info);
+    std::pair<int, int> context =
+        calculateContext(binary.specs, pa, "", false);
+    // the window stays in the pre targets
+    est.addWindow(est, context.first + context.second, context.first,
+                  targetFraction(binary.pre_targets, platform));
+  } break;
+  case ICType::Invariant: {
+    const UnaryInfo &unary = dynamic_cast<const UnaryInfo &>(info);
+    est.restrict(pa_index, pa_index,
+                 targetFraction(unary.specs.targets, platform));
+  } break;
+  case ICType::UntilChain: {
+    const ChainInfo &chain = dynamic_cast<const ChainInfo &>(info);
+    std::size_t end_pa_index = po_tls.planActionIndex(end_pa);
+    if (end_pa_index == PlanOrderedTLs::npos || end_pa_index <= pa_index) {
+      std::cout << "DirectEncoder estimateActivation: could not find end pa "
+                << end_pa << std::endl;
+      return;
+    }
+    // the chain replaces the timelines by one window per part of the chain
+    EncodingEstimate orig = est;
+    est.restrict(pa_index, end_pa_index - 1, 0);
+    int lb_acc = 0;
+    int ub_acc = 0;
+    for (const auto &specs : chain.specs_list) {
+      std::pair<int, int> context =
+          calculateContext(specs, pa, end_pa, true, lb_acc, ub_acc);
+      lb_acc += specs.bounds.lower_bound;
+      ub_acc = safeAddition(ub_acc, specs.bounds.upper_bound);
+      est.addWindow(orig, context.first, context.first + context.second,
+                    targetFraction(specs.targets, platform));
+    }
+  } break;
+  default:
+    // no-ops only remove transitions
+    break;
+  }
+}
+
+/**
+ * \internal
+ * Builds the base timelines of the new plan and replaces the first ones by
+ * those of the previous encoding. Activations of the previous encoding that
+ * ended before them are taken over, so the result can be updated again.
+ * \endinternal
+ */
+DirectEncoder::DirectEncoder(const DirectEncoder &prev, AutomataSystem &s,
+                             const ::std::vector<PlanAction> &plan,
+                             size_t keep, const int base_pos)
+    : DirectEncoder(s, plan, base_pos) {
+  keep = std::min(keep, std::min(po_tls.pa_order->size(),
+                                 prev.po_tls.pa_order->size()));
+  for (size_t i = 0; i < keep; i++) {
+    const Symbol &pa = po_tls.pa_order->at(i);
+    auto prev_tl = prev.po_tls.tls->find(pa);
+    if (prev_tl == prev.po_tls.tls->end()) {
+      std::cout << "DirectEncoder: previous encoding has no timeline for pa "
+                << pa << std::endl;
+      continue;
+    }
+    po_tls.tls->find(pa)->second = prev_tl->second;
+  }
+  for (const auto &act : prev.activations) {
+    if (act.last < keep) {
+      activations.push_back(act);
+      if (act.clock != nullptr) {
+        s.globals.clocks.insert(act.clock);
+      }
+    }
+  }
+}
+
 DirectEncoder DirectEncoder::mergeEncodings(const DirectEncoder &enc2) const {
   return DirectEncoder(po_tls.mergePlanOrderedTLs(enc2.po_tls), plan,
                        plan_ta_index);
@@ -838,14 +1107,17 @@ DirectEncoder::DirectEncoder(const PlanOrderedTLs &tls,
                              const ::std::vector<PlanAction> &plan,
                              size_t plan_ta_index)
     : plan(plan), plan_ta_index(plan_ta_index) {
+  computeDurationSums();
   for (const auto &tl : *(tls.tls.get())) {
     po_tls.tls.get()->emplace(tl);
   }
   for (const auto &pa : *(tls.pa_order.get())) {
-    po_tls.pa_order.get()->push_back(pa);
+    po_tls.addPlanAction(pa);
   }
 }
 
 DirectEncoder DirectEncoder::copy() {
-  return DirectEncoder(po_tls, plan, plan_ta_index);
+  DirectEncoder res(po_tls, plan, plan_ta_index);
+  res.activations = activations;
+  return res;
 }
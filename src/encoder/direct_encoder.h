@@ -9,14 +9,32 @@
 #include "../timed-automata/vis_info.h"
 #include "enc_interconnection_info.h"
 #include "encoder_utils.h"
+#include "encoding_estimate.h"
 #include "filter.h"
 #include "plan_ordered_tls.h"
+#include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace taptenc {
-typedef ::std::unordered_map<::std::string, ::std::string> OrigMap;
+/**
+ * Range of timelines that was modified by encoding one constraint.
+ *
+ * Positions refer to the plan order of the encoding. The range always
+ * contains the plan action that activated the constraint.
+ */
+struct encodedActivation {
+  /** position of the first modified timeline */
+  size_t first;
+  /** position of the last modified timeline */
+  size_t last;
+  /** clock introduced by the encoding, nullptr if there is none */
+  ::std::shared_ptr<Clock> clock;
+};
+typedef struct encodedActivation EncodedActivation;
+
 /**
  * Encodes temporal constraints by creating copies of the platform TAs to
  * represent different timelines.
@@ -66,17 +84,58 @@ private:
    * Required to calculate the context of constraints (see calculateContext()).
    */
   ::std::vector<PlanAction> plan;
+  /**
+   * Accumulated durations of \a plan, entry i holds the sum of the lower
+   * (upper) duration bounds of the first i plan actions.
+   *
+   * Unbounded upper bounds are not summed up but counted in \a ub_unbounded.
+   */
+  ::std::vector<long long> lb_sums;
+  ::std::vector<long long> ub_sums;
+  /** Entry i holds the number of unbounded plan actions among the first i. */
+  ::std::vector<size_t> ub_unbounded;
   /** Stores the position of the plan TA inside the automata system used to
    * construct the encoder instance.
    */
   size_t plan_ta_index;
+  /** Marks windows that are not part of an until chain. */
+  static constexpr size_t npos_chain = ::std::numeric_limits<size_t>::max();
+  /**
+   * Name of a window created while encoding a constraint.
+   *
+   * The name only depends on the constraint, the plan action activating it
+   * and the position of the window within an until chain. Hence one
+   * constraint firing multiple times during a plan with overlapping active
+   * windows gets unique names, and a window reused from a previous encoding
+   * is named as if the new plan was encoded from scratch.
+   *
+   * @param constraint name of the encoded constraint
+   * @param pa_index position of the activating plan action
+   * @param chain_pos position of the window within an until chain
+   * @return prefix of the window timelines
+   */
+  static ::std::string windowName(const ::std::string &constraint,
+                                  size_t pa_index,
+                                  size_t chain_pos = npos_chain);
   /**
-   * Counts the number of encoded constraints.
+   * Timelines modified by the encoded constraints in the order they were
+   * encoded.
    *
-   * Used to ensure unique clock names to avoid problems when one constraint
-   * fires multiple times during a plan with overlapping active window.
+   * Used to determine which timelines can be reused when the plan changes
+   * (see reusableTimelines()).
    */
-  size_t encode_counter = 0;
+  ::std::vector<EncodedActivation> activations;
+  /**
+   * Records the range of timelines modified by an encoding step.
+   *
+   * @param first position of the first modified timeline, the timeline
+   *              before it is included as well since transitions to \a first
+   *              are stored there
+   * @param last position of the last modified timeline
+   * @param clock clock introduced by the encoding step
+   */
+  void recordActivation(size_t first, size_t last,
+                        ::std::shared_ptr<Clock> clock = nullptr);
   /**
    * Creates a product TA between platform TA and plan TA.
    *
@@ -86,7 +145,7 @@ private:
    * Plan action  :  a1  a2  a3  ...   an
    * Base Timeline:  M - M - M - ... - M
    *
-   * po_tls[ai][ai].ta = M
+   * po_tls[ai][ai].toAutomaton() = M (all copies share M)
    *~~~
    * @param s Automata system that contains the platform model and the plan
    * @param base_pos position of the platform model in
@@ -96,6 +155,26 @@ private:
   void generateBaseTimeLine(AutomataSystem &s, const int base_pos,
                             const int plan_pos);
 
+  /** Computes \a lb_sums, \a ub_sums and \a ub_unbounded from \a plan. */
+  void computeDurationSums();
+  /**
+   * Sum of the lower duration bounds of a range of plan actions.
+   *
+   * @param first index of the first plan action of the range
+   * @param last index of the last plan action of the range
+   * @return accumulated lower bound
+   */
+  long long lowerDuration(size_t first, size_t last) const;
+  /**
+   * Sum of the upper duration bounds of a range of plan actions.
+   *
+   * @param first index of the first plan action of the range
+   * @param last index of the last plan action of the range
+   * @return accumulated upper bound, std::numeric_limits<int>::max() if it
+   *         is unbounded
+   */
+  long long upperDuration(size_t first, size_t last) const;
+
   /**
    * Calculate the window of plan actions during which a temporal constraint is
    * active.
@@ -325,24 +404,87 @@ public:
   DirectEncoder(AutomataSystem &s, const ::std::vector<PlanAction> &plan,
                 const int base_pos = 0);
 
+  /**
+   * Creates a DirectEncoder instance for a changed plan that reuses the
+   * first timelines of a previous encoding.
+   *
+   * The constraints activated within the reused timelines are already
+   * encoded, all other constraints still have to be encoded.
+   *
+   * @param prev encoding of the previous plan
+   * @param s automata system containing the platform model
+   * @param plan the changed plan
+   * @param keep number of timelines to reuse, obtained by
+   *             prev.reusableTimelines()
+   * @param base_pos position of the platform model TA in \a s
+   */
+  DirectEncoder(const DirectEncoder &prev, AutomataSystem &s,
+                const ::std::vector<PlanAction> &plan, size_t keep,
+                const int base_pos = 0);
+
   DirectEncoder() = default;
 
+  /**
+   * Predicts the base timelines of this encoder before any constraint is
+   * encoded.
+   *
+   * @param platform platform model TA the encoder was created with
+   * @return prediction of the base timelines
+   */
+  EncodingEstimate estimateBase(const Automaton &platform) const;
+  /**
+   * Measures the current size of the encoding per timeline.
+   *
+   * @return size of the timelines, not counting the query timeline
+   */
+  EncodingEstimate measure() const;
+  /**
+   * Predicts the effect of encoding a constraint without encoding it.
+   *
+   * @param est prediction to update
+   * @param platform platform model TA the encoder was created with
+   * @param info constraint to predict
+   * @param pa plan action where the constraint is activated
+   * @param end_pa plan action that ends an until chain, ignored for other
+   *        constraints
+   */
+  void estimateActivation(EncodingEstimate &est, const Automaton &platform,
+                          const EncICInfo &info, const ::std::string &pa,
+                          const ::std::string &end_pa = "");
+
+  /**
+   * Determines how many timelines of this encoding stay valid if the plan is
+   * replaced by another one sharing a prefix with it.
+   *
+   * A timeline stays valid if it only depends on the shared prefix and no
+   * encoded constraint connects it to a timeline that has to be rebuilt.
+   *
+   * @param new_plan the changed plan
+   * @param limit upper bound on the result
+   * @return number of leading timelines (in plan order) that can be reused
+   */
+  size_t reusableTimelines(const ::std::vector<PlanAction> &new_plan,
+                           size_t limit = PlanOrderedTLs::npos) const;
+  /**
+   * @return timelines modified by the encoded constraints, in the order they
+   *         were encoded
+   */
+  const ::std::vector<EncodedActivation> &getActivations() const {
+    return activations;
+  }
+
   /**
    * Converts the PlanOrderedTLs representation of the encoding to an automata
-   * systen containing only one automaton and creates visual information for
-   * that system.
+   * systen containing only one automaton.
    *
    * Before converting the representation, iterative pruning is applied to
    * ignore automata copies without outgoing transitions.
    *
    * @param s automata system containing the platform model and plan automaton
-   * @param s_vis instance to store the visual information associated with the
-   *              output automata system
    * @return automata system containing the automata that contains all encoding
    *         information
    */
-  AutomataSystem createFinalSystem(const AutomataSystem &s,
-                                   SystemVisInfo &s_vis);
+  AutomataSystem createFinalSystem(const AutomataSystem &s);
   /**
    * Create a DirectEncoder Instance containing a merged encoding of this and
    * the argument encoding.
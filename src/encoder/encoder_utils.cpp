@@ -6,33 +6,68 @@
 
 #include "encoder_utils.h"
 #include "../constants.h"
+#include "../timed-automata/state_id.h"
 #include "../timed-automata/timed_automata.h"
 #include "../utils.h"
 #include "filter.h"
 #include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 using namespace taptenc;
 
+namespace {
+/** Hashes the object behind a pointer, see derefEqual. */
+struct derefHash {
+  template <class T> ::std::size_t operator()(const T *p) const {
+    return ::std::hash<T>{}(*p);
+  }
+};
+/** Compares the objects behind pointers, used to dedup without copies. */
+struct derefEqual {
+  template <class T> bool operator()(const T *l, const T *r) const {
+    return *l == *r;
+  }
+};
+
+/**
+ * Removes structurally equal elements, the first occurrence is kept.
+ *
+ * @param elems elements to deduplicate in place
+ */
+template <class T> void removeDuplicates(::std::vector<T> &elems) {
+  ::std::unordered_set<const T *, derefHash, derefEqual> seen;
+  ::std::vector<bool> keep(elems.size());
+  for (::std::size_t i = 0; i < elems.size(); i++) {
+    keep[i] = seen.insert(&elems[i]).second;
+  }
+  ::std::size_t kept = 0;
+  for (::std::size_t i = 0; i < elems.size(); i++) {
+    if (keep[i]) {
+      if (kept != i) {
+        elems[kept] = ::std::move(elems[i]);
+      }
+      kept++;
+    }
+  }
+  elems.erase(elems.begin() + kept, elems.end());
+}
+} // end anonymous namespace
+
 ::std::shared_ptr<Clock> encoderutils::addClock(update_t &update,
                                                 const ::std::string clock_id) {
-  auto clock_search =
-      std::find_if(update.begin(), update.end(), [clock_id](const auto &cl) {
-        return clock_id == cl.get()->id;
-      });
-  if (clock_search != update.end()) {
-    // std::cout << "encoderutils: clock name already in use: " << clock_id
-    //           << std::endl;
-    return *clock_search;
-  } else {
-    auto clock_res = std::make_shared<Clock>(clock_id);
-    update.insert(clock_res);
-    return clock_res;
-  }
+  const std::shared_ptr<Clock> &clock_res = ClockSet::clockOf(clock_id);
+  update.insert(clock_res);
+  return clock_res;
 }
 
 Automaton
@@ -52,10 +87,10 @@ encoderutils::generatePlanAutomaton(const ::std::vector<PlanAction> &plan,
       std::make_shared<Clock>(constants::GLOBAL_CLOCK);
   for (auto it = full_plan.begin(); it != full_plan.end(); ++it) {
     if (it != full_plan.begin()) {
-      plan_states.back().inv = std::make_unique<ConjunctionCC>(
-          ConjunctionCC(*plan_states.back().inv.get(),
+      plan_states.back().inv =
+          addConstraint(*plan_states.back().inv.get(),
                         ComparisonCC(abs_clock, it->absolute_time.r_op,
-                                     it->absolute_time.upper_bound)));
+                                     it->absolute_time.upper_bound));
     }
     if (it->name.id == constants::START_PA) {
       plan_states.push_back(State(it->name.id, TrueCC(), false, true));
@@ -104,46 +139,254 @@ Automaton
 encoderutils::mergeAutomata(const ::std::vector<Automaton> &automata,
                             ::std::vector<Transition> &interconnections,
                             ::std::string prefix) {
-  std::set<State> res_states;
-  std::set<Transition> res_transitions(interconnections.begin(),
-                                       interconnections.end());
-  std::set<std::shared_ptr<Clock>> res_clocks;
+  // duplicates are detected by structural hashing, the first occurrence wins
+  std::unordered_set<const State *, derefHash, derefEqual> seen_states;
+  std::unordered_set<const Transition *, derefHash, derefEqual>
+      seen_transitions;
+  std::vector<State> res_states;
+  std::vector<Transition> res_transitions;
+  ClockSet res_clocks;
   std::set<std::string> res_bool_vars;
+  for (const auto &tr : interconnections) {
+    if (seen_transitions.insert(&tr).second) {
+      res_transitions.push_back(tr);
+    }
+  }
   for (const auto &ta : automata) {
-    res_states.insert(ta.states.begin(), ta.states.end());
-    res_transitions.insert(ta.transitions.begin(), ta.transitions.end());
-    for (const auto &cl : ta.clocks) {
-      addClock(res_clocks, cl.get()->id);
+    for (const auto &s : ta.states) {
+      if (seen_states.insert(&s).second) {
+        res_states.push_back(s);
+      }
+    }
+    for (const auto &tr : ta.transitions) {
+      if (seen_transitions.insert(&tr).second) {
+        res_transitions.push_back(tr);
+      }
     }
+    res_clocks |= ta.clocks;
     res_bool_vars.insert(ta.bool_vars.begin(), ta.bool_vars.end());
   }
-  Automaton res(
-      std::vector<State>(res_states.begin(), res_states.end()),
-      std::vector<Transition>(res_transitions.begin(), res_transitions.end()),
-      prefix, false);
-  res.clocks =
-      std::set<std::shared_ptr<Clock>>(res_clocks.begin(), res_clocks.end());
+  Automaton res(std::move(res_states), std::move(res_transitions), prefix,
+                false);
+  res.clocks = res_clocks;
   res.bool_vars =
       std::vector<std::string>(res_bool_vars.begin(), res_bool_vars.end());
   return res;
 }
 
+Automaton
+encoderutils::mergeAutomata(const ::std::vector<const TlEntry *> &copies,
+                            ::std::vector<Transition> &interconnections,
+                            ::std::string prefix) {
+  // the states and transitions of each copy are materialized only once,
+  // directly into the merged automaton
+  std::vector<State> res_states;
+  std::vector<Transition> res_transitions(interconnections.begin(),
+                                          interconnections.end());
+  ClockSet res_clocks;
+  std::set<std::string> res_bool_vars;
+  for (const TlEntry *copy : copies) {
+    std::vector<State> states = copy->states();
+    std::move(states.begin(), states.end(), std::back_inserter(res_states));
+    std::vector<Transition> transitions = copy->transitions();
+    std::move(transitions.begin(), transitions.end(),
+              std::back_inserter(res_transitions));
+    res_clocks |= copy->clocks;
+    const auto &bool_vars = copy->getShared().ta.bool_vars;
+    res_bool_vars.insert(bool_vars.begin(), bool_vars.end());
+  }
+  removeDuplicates(res_states);
+  removeDuplicates(res_transitions);
+  Automaton res(std::move(res_states), std::move(res_transitions), prefix,
+                false);
+  res.clocks = res_clocks;
+  res.bool_vars =
+      std::vector<std::string>(res_bool_vars.begin(), res_bool_vars.end());
+  return res;
+}
+
+Automaton encoderutils::sliceAutomaton(const Automaton &ta,
+                                       const Symbol &target) {
+  AutomatonIndex index(ta);
+  std::vector<bool> forward(ta.states.size(), false);
+  std::vector<bool> backward(ta.states.size(), false);
+  std::vector<size_t> worklist;
+  for (size_t i = 0; i < ta.states.size(); i++) {
+    if (ta.states[i].initial) {
+      forward[i] = true;
+      worklist.push_back(i);
+    }
+  }
+  while (!worklist.empty()) {
+    size_t curr = worklist.back();
+    worklist.pop_back();
+    for (size_t trans_pos : index.outgoing(curr)) {
+      size_t dest = index.stateIndex(ta.transitions[trans_pos].dest_id);
+      if (dest != AutomatonIndex::npos && !forward[dest]) {
+        forward[dest] = true;
+        worklist.push_back(dest);
+      }
+    }
+  }
+  size_t target_pos = index.stateIndex(target);
+  if (target_pos != AutomatonIndex::npos) {
+    backward[target_pos] = true;
+    worklist.push_back(target_pos);
+  }
+  while (!worklist.empty()) {
+    size_t curr = worklist.back();
+    worklist.pop_back();
+    for (size_t trans_pos : index.incoming(curr)) {
+      size_t source = index.stateIndex(ta.transitions[trans_pos].source_id);
+      if (source != AutomatonIndex::npos && !backward[source]) {
+        backward[source] = true;
+        worklist.push_back(source);
+      }
+    }
+  }
+  std::vector<bool> keep(ta.states.size(), false);
+  std::vector<State> res_states;
+  for (size_t i = 0; i < ta.states.size(); i++) {
+    keep[i] = (forward[i] && backward[i]) || ta.states[i].initial ||
+              i == target_pos;
+    if (keep[i]) {
+      res_states.push_back(ta.states[i]);
+    }
+  }
+  std::vector<Transition> res_transitions;
+  for (const auto &trans : ta.transitions) {
+    size_t source = index.stateIndex(trans.source_id);
+    size_t dest = index.stateIndex(trans.dest_id);
+    if (source != AutomatonIndex::npos && dest != AutomatonIndex::npos &&
+        keep[source] && keep[dest]) {
+      res_transitions.push_back(trans);
+    }
+  }
+  Automaton res(std::move(res_states), std::move(res_transitions), ta.prefix,
+                false);
+  res.clocks = ta.clocks;
+  res.bool_vars = ta.bool_vars;
+  return res;
+}
+
+/**
+ * \internal
+ * Partition refinement by signatures: each round splits the blocks of the
+ * current partition by the set of (transition label, successor block) pairs
+ * of their states until no block is split anymore.
+ * \endinternal
+ */
+Automaton encoderutils::minimizeAutomaton(const Automaton &ta) {
+  AutomatonIndex index(ta);
+  size_t num_states = ta.states.size();
+  std::vector<size_t> block(num_states);
+  size_t num_blocks = 0;
+  {
+    std::map<std::tuple<size_t, bool, bool, bool, Symbol, Symbol>, size_t>
+        initial_blocks;
+    for (size_t i = 0; i < num_states; i++) {
+      const State &s = ta.states[i];
+      const StateId &s_id = StateId::of(s.id);
+      auto emp = initial_blocks.emplace(
+          std::make_tuple(s.inv->index, s.urgent, s.initial,
+                          s.id == constants::QUERY, s_id.plan_action,
+                          s_id.base),
+          initial_blocks.size());
+      block[i] = emp.first->second;
+    }
+    num_blocks = initial_blocks.size();
+  }
+  // transitions are labeled by everything but their endpoints and action
+  std::vector<size_t> trans_label(ta.transitions.size());
+  {
+    std::map<std::tuple<size_t, update_t, std::string, bool>, size_t> labels;
+    for (size_t i = 0; i < ta.transitions.size(); i++) {
+      const Transition &trans = ta.transitions[i];
+      auto emp = labels.emplace(std::make_tuple(trans.guard->index,
+                                                trans.update, trans.sync,
+                                                trans.passive),
+                                labels.size());
+      trans_label[i] = emp.first->second;
+    }
+  }
+  // dangling transitions keep AutomatonIndex::npos and are ignored
+  std::vector<size_t> trans_dest(ta.transitions.size());
+  for (size_t i = 0; i < ta.transitions.size(); i++) {
+    trans_dest[i] = index.stateIndex(ta.transitions[i].dest_id);
+  }
+  while (true) {
+    std::map<std::pair<size_t, std::vector<std::pair<size_t, size_t>>>,
+             size_t>
+        signatures;
+    std::vector<size_t> next_block(num_states);
+    for (size_t i = 0; i < num_states; i++) {
+      std::vector<std::pair<size_t, size_t>> sig;
+      for (size_t trans_pos : index.outgoing(i)) {
+        if (trans_dest[trans_pos] == AutomatonIndex::npos) {
+          continue;
+        }
+        sig.push_back(std::make_pair(trans_label[trans_pos],
+                                     block[trans_dest[trans_pos]]));
+      }
+      std::sort(sig.begin(), sig.end());
+      sig.erase(std::unique(sig.begin(), sig.end()), sig.end());
+      auto emp = signatures.emplace(std::make_pair(block[i], std::move(sig)),
+                                    signatures.size());
+      next_block[i] = emp.first->second;
+    }
+    block = std::move(next_block);
+    if (signatures.size() == num_blocks) {
+      break;
+    }
+    num_blocks = signatures.size();
+  }
+  // the first state of each block represents it
+  std::vector<size_t> rep(num_blocks, num_states);
+  std::vector<State> res_states;
+  for (size_t i = 0; i < num_states; i++) {
+    if (rep[block[i]] == num_states) {
+      rep[block[i]] = i;
+      res_states.push_back(ta.states[i]);
+    }
+  }
+  std::vector<Transition> res_transitions;
+  std::set<std::tuple<size_t, size_t, size_t>> added_transitions;
+  for (size_t i = 0; i < ta.transitions.size(); i++) {
+    size_t source = index.stateIndex(ta.transitions[i].source_id);
+    if (source == AutomatonIndex::npos ||
+        trans_dest[i] == AutomatonIndex::npos) {
+      continue;
+    }
+    if (added_transitions
+            .insert(std::make_tuple(block[source], trans_label[i],
+                                    block[trans_dest[i]]))
+            .second) {
+      Transition trans = ta.transitions[i];
+      trans.source_id = ta.states[rep[block[source]]].id;
+      trans.dest_id = ta.states[rep[block[trans_dest[i]]]].id;
+      res_transitions.push_back(trans);
+    }
+  }
+  Automaton res(std::move(res_states), std::move(res_transitions), ta.prefix,
+                false);
+  res.clocks = ta.clocks;
+  res.bool_vars = ta.bool_vars;
+  return res;
+}
+
 ::std::vector<Transition> encoderutils::createCopyTransitionsBetweenTAs(
     const Automaton &source, const Automaton &dest,
     const ::std::vector<State> &filter, const ClockConstraint &guard,
     const update_t &update, ::std::string sync, bool passive) {
   std::vector<Transition> res_transitions;
   for (const auto &f_state : filter) {
+    const Symbol &f_base = StateId::of(f_state.id).base;
     auto c_source = std::find_if(
-        source.states.begin(), source.states.end(), [f_state](const State &s) {
-          return Filter::getSuffix(s.id, constants::BASE_SEP) ==
-                 Filter::getSuffix(f_state.id, constants::BASE_SEP);
-        });
+        source.states.begin(), source.states.end(),
+        [&f_base](const State &s) { return StateId::of(s.id).base == f_base; });
     auto c_dest = std::find_if(
-        dest.states.begin(), dest.states.end(), [f_state](const State &s) {
-          return Filter::getSuffix(s.id, constants::BASE_SEP) ==
-                 Filter::getSuffix(f_state.id, constants::BASE_SEP);
-        });
+        dest.states.begin(), dest.states.end(),
+        [&f_base](const State &s) { return StateId::of(s.id).base == f_base; });
     if (c_source != source.states.end() && c_dest != dest.states.end()) {
       res_transitions.push_back(Transition(c_source->id, c_dest->id, "", guard,
                                            update, sync, passive));
@@ -158,19 +401,19 @@ encoderutils::mergeAutomata(const ::std::vector<Automaton> &automata,
     const update_t &update) {
   std::vector<Transition> res_transitions;
   for (const auto &trans : base.transitions) {
-    auto search =
-        std::find_if(filter.begin(), filter.end(), [trans](const State &s) {
-          return Filter::getSuffix(s.id, constants::BASE_SEP) ==
-                 Filter::getSuffix(trans.source_id, constants::BASE_SEP);
-        });
+    const Symbol &source_base = StateId::of(trans.source_id).base;
+    auto search = std::find_if(filter.begin(), filter.end(),
+                               [&source_base](const State &s) {
+                                 return StateId::of(s.id).base == source_base;
+                               });
     if (search != filter.end()) {
       auto source_state =
           std::find_if(source.states.begin(), source.states.end(),
                        [search](const State &s) { return s.id == search->id; });
+      const Symbol &dest_base = StateId::of(trans.dest_id).base;
       auto dest_state = std::find_if(
-          dest.states.begin(), dest.states.end(), [trans](const State &s) {
-            return Filter::getSuffix(s.id, constants::BASE_SEP) ==
-                   Filter::getSuffix(trans.dest_id, constants::BASE_SEP);
+          dest.states.begin(), dest.states.end(), [&dest_base](const State &s) {
+            return StateId::of(s.id).base == dest_base;
           });
       if (source_state != source.states.end() &&
           dest_state != dest.states.end()) {
@@ -184,6 +427,68 @@ encoderutils::mergeAutomata(const ::std::vector<Automaton> &automata,
   return res_transitions;
 }
 
+namespace {
+/**
+ * @param entry copy within a timeline
+ * @return id of the first state of \a entry with a given base part, by base
+ *         part
+ */
+std::unordered_map<Symbol, Symbol> firstIdByBase(const TlEntry &entry) {
+  std::unordered_map<Symbol, Symbol> res;
+  for (size_t i = 0; i < entry.sharedSize(); i++) {
+    if (entry.isActive(i)) {
+      res.emplace(entry.baseOf(i), entry.stateId(i));
+    }
+  }
+  return res;
+}
+} // end anonymous namespace
+
+::std::vector<Transition> encoderutils::createCopyTransitionsBetweenTAs(
+    const TlEntry &source, const TlEntry &dest, const TlEntry &filter,
+    const ClockConstraint &guard, const update_t &update, ::std::string sync,
+    bool passive) {
+  std::vector<Transition> res_transitions;
+  std::unordered_map<Symbol, Symbol> source_ids = firstIdByBase(source);
+  std::unordered_map<Symbol, Symbol> dest_ids = firstIdByBase(dest);
+  for (size_t i = 0; i < filter.sharedSize(); i++) {
+    if (!filter.isActive(i)) {
+      continue;
+    }
+    auto c_source = source_ids.find(filter.baseOf(i));
+    auto c_dest = dest_ids.find(filter.baseOf(i));
+    if (c_source != source_ids.end() && c_dest != dest_ids.end()) {
+      res_transitions.push_back(Transition(c_source->second, c_dest->second,
+                                           "", guard, update, sync, passive));
+    }
+  }
+  return res_transitions;
+}
+
+::std::vector<Transition> encoderutils::createSuccessorTransitionsBetweenTAs(
+    const Automaton &base, const TlEntry &source, const TlEntry &dest,
+    const TlEntry &filter, const ClockConstraint &guard,
+    const update_t &update) {
+  std::vector<Transition> res_transitions;
+  std::unordered_map<Symbol, Symbol> filter_ids = firstIdByBase(filter);
+  std::unordered_map<Symbol, Symbol> dest_ids = firstIdByBase(dest);
+  for (const auto &trans : base.transitions) {
+    auto source_state = filter_ids.find(StateId::of(trans.source_id).base);
+    if (source_state == filter_ids.end() ||
+        (&filter != &source && !source.containsState(source_state->second))) {
+      continue;
+    }
+    auto dest_state = dest_ids.find(StateId::of(trans.dest_id).base);
+    if (dest_state != dest_ids.end()) {
+      res_transitions.push_back(
+          Transition(source_state->second, dest_state->second, trans.action,
+                     *addConstraint(*trans.guard.get(), guard).get(),
+                     addUpdate(trans.update, update), trans.sync, true));
+    }
+  }
+  return res_transitions;
+}
+
 void encoderutils::addTrapTransitions(Automaton &ta,
                                       const ::std::vector<State> &sources,
                                       const ClockConstraint &guard,
@@ -275,14 +580,11 @@ std::string encoderutils::mergeActions(::std::string action1,
   return action1 + constants::ACTION_SEP + action2;
 }
 
-std::string encoderutils::mergeIds(::std::string id1, ::std::string id2) {
-  if (id1.find(constants::BASE_SEP) != std::string::npos) {
-    std::string new_prefix_add = Filter::getPrefix(
-        Filter::getSuffix(id1, constants::TL_SEP), constants::BASE_SEP);
+std::string encoderutils::mergeIds(const Symbol &id1, const Symbol &id2) {
+  if (id1.str().find(constants::BASE_SEP) != std::string::npos) {
+    const StateId &parts = StateId::of(id1);
     return encoderutils::addToPrefix(
-        encoderutils::addToBaseId(id2,
-                                  Filter::getSuffix(id1, constants::BASE_SEP)),
-        new_prefix_add);
+        encoderutils::addToBaseId(id2, parts.base), parts.window);
   } else {
     return encoderutils::addToBaseId(id2, id1);
   }
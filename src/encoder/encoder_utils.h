@@ -45,6 +45,48 @@ namespace encoderutils {
 Automaton mergeAutomata(const ::std::vector<Automaton> &automata,
                         ::std::vector<Transition> &interconnections,
                         ::std::string prefix);
+/**
+ * Merges timeline copies like mergeAutomata() does with the automata formed
+ * by the copies, without materializing each copy as an automaton first.
+ *
+ * @param copies timeline copies to merge together
+ * @param interconnections transitions between the copies
+ * @param prefix prefix of the merged automaton
+ * @return Automaton consisting of all states and transitions from the
+ *         copies in \a copies and the transitions from \a interconnections
+ */
+Automaton mergeAutomata(const ::std::vector<const TlEntry *> &copies,
+                        ::std::vector<Transition> &interconnections,
+                        ::std::string prefix);
+
+/**
+ * Removes all states that do not lie on a path from an initial state to a
+ * target state, ignoring clock constraints.
+ *
+ * Initial states and the target state are always kept.
+ *
+ * @param ta automaton to slice
+ * @param target id of the state that has to be reachable
+ * @return \a ta restricted to the states that are reachable from an initial
+ *         state and from which \a target is reachable, as well as the
+ *         transitions between them
+ */
+Automaton sliceAutomaton(const Automaton &ta, const Symbol &target);
+
+/**
+ * Merges states that are bisimilar when clocks are treated symbolically.
+ *
+ * Two states are merged, if they have the same invariant, urgency, initial
+ * flag, plan action and base id and their outgoing transitions with equal
+ * guards, updates and syncs lead to merged states. Hence, the resulting
+ * automaton has the same timed behaviour and traces can still be mapped to
+ * plan actions and platform states. Merged states are represented by the
+ * first of them.
+ *
+ * @param ta automaton to minimize
+ * @return quotient of \a ta with respect to the coarsest such bisimulation
+ */
+Automaton minimizeAutomaton(const Automaton &ta);
 
 /**
  * Creates transitions from a TA to one of its copies from each state to its
@@ -86,6 +128,47 @@ Automaton mergeAutomata(const ::std::vector<Automaton> &automata,
     const ::std::vector<State> &filter, const ClockConstraint &guard,
     const update_t &update);
 
+/**
+ * Creates transitions between copies within timelines, see
+ * createCopyTransitionsBetweenTAs() on automata.
+ *
+ * The copies are not materialized.
+ *
+ * @param source copy with the source states
+ * @param dest copy with the dest states
+ * @param filter copy with the states that should be connected (typically
+ *        \a source or \a dest)
+ * @param guard guard on the created transitions
+ * @param update update on the created transitions
+ * @param sync sync channel on the created transitions
+ * @param passive is the sync emitting or receiving?
+ */
+::std::vector<Transition>
+createCopyTransitionsBetweenTAs(const TlEntry &source, const TlEntry &dest,
+                                const TlEntry &filter,
+                                const ClockConstraint &guard,
+                                const update_t &update, ::std::string sync,
+                                bool passive = true);
+
+/**
+ * Creates transitions between copies within timelines, see
+ * createSuccessorTransitionsBetweenTAs() on automata.
+ *
+ * The copies are not materialized.
+ *
+ * @param base automaton with all transitions that should be considered
+ * @param source copy with the source states
+ * @param dest copy with the dest states
+ * @param filter copy with the states that should be connected (typically
+ *        \a source)
+ * @param guard guard on the created transitions
+ * @param update update on the created transitions
+ */
+::std::vector<Transition> createSuccessorTransitionsBetweenTAs(
+    const Automaton &base, const TlEntry &source, const TlEntry &dest,
+    const TlEntry &filter, const ClockConstraint &guard,
+    const update_t &update);
+
 /**
  * Adds transitions to the trap state.
  *
@@ -180,7 +263,7 @@ void addInvariants(Automaton &ta, const ::std::vector<State> filter,
  * @return id1 with id2's base id appended and id2's prefix (between
  *         constants::TL_SEP and constants::BASE_SEP) added to it's own prefix
  */
-::std::string mergeIds(::std::string id1, ::std::string id2);
+::std::string mergeIds(const Symbol &id1, const Symbol &id2);
 
 /**
  * Construct a plan automaton from a sequential plan.
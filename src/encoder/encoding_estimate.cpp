@@ -0,0 +1,113 @@
+/** \file
+ * Size prediction of direct encodings and budgets to limit their size.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+#include "encoding_estimate.h"
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <sstream>
+
+using namespace taptenc;
+
+encodingEstimate::encodingEstimate(size_t num_timelines,
+                                   const Automaton &platform)
+    : states(num_timelines, platform.states.size()),
+      transitions(num_timelines, platform.transitions.size()),
+      // each state has a copy transition to the next timeline
+      outgoing(num_timelines, platform.states.size()) {}
+
+void encodingEstimate::addWindow(const encodingEstimate &orig, size_t first,
+                                 size_t last, double fraction) {
+  last = std::min(last, std::min(states.size(), orig.states.size()) - 1);
+  for (size_t i = first; i <= last && i < states.size(); i++) {
+    double orig_states = orig.states[i];
+    double orig_transitions = orig.transitions[i];
+    double orig_outgoing = orig.outgoing[i];
+    states[i] += fraction * orig_states;
+    transitions[i] += fraction * orig_transitions;
+    // the copies are connected to the originals as well
+    outgoing[i] += fraction * (orig_outgoing + orig_states);
+  }
+}
+
+void encodingEstimate::restrict(size_t first, size_t last, double fraction) {
+  for (size_t i = first; i <= last && i < states.size(); i++) {
+    states[i] *= fraction;
+    transitions[i] *= fraction;
+    outgoing[i] *= fraction;
+  }
+}
+
+/**
+ * \internal
+ * Merging replaces each state of a timeline by the whole timeline of the
+ * other encoding, transitions between timelines are paired.
+ * \endinternal
+ */
+encodingEstimate encodingEstimate::merge(const encodingEstimate &other) const {
+  encodingEstimate res;
+  size_t num_timelines = std::min(states.size(), other.states.size());
+  for (size_t i = 0; i < num_timelines; i++) {
+    res.states.push_back(states[i] * other.states[i]);
+    res.transitions.push_back(transitions[i] * other.states[i] +
+                              states[i] * other.transitions[i]);
+    res.outgoing.push_back(outgoing[i] * other.outgoing[i]);
+  }
+  return res;
+}
+
+double encodingEstimate::numStates() const {
+  return std::accumulate(states.begin(), states.end(), 1.0);
+}
+
+double encodingEstimate::numTransitions() const {
+  return std::accumulate(transitions.begin(), transitions.end(), 0.0) +
+         std::accumulate(outgoing.begin(), outgoing.end(), 0.0);
+}
+
+double encodingEstimate::memoryBytes() const {
+  return numStates() * sizeof(State) + numTransitions() * sizeof(Transition);
+}
+
+EncodingBudget::EncodingBudget(double max_states, double max_memory_bytes)
+    : max_states(max_states), max_memory_bytes(max_memory_bytes) {}
+
+EncodingBudget EncodingBudget::fromEnv() {
+  const char *max_states = std::getenv("TAPTENC_MAX_STATES");
+  const char *max_memory = std::getenv("TAPTENC_MAX_MEMORY_MB");
+  return EncodingBudget(
+      max_states == nullptr ? 0 : std::strtod(max_states, nullptr),
+      max_memory == nullptr ? 0
+                            : std::strtod(max_memory, nullptr) * 1024 * 1024);
+}
+
+void EncodingBudget::check(const EncodingEstimate &est,
+                           const std::string &stage) const {
+  check(est.numStates(), est.memoryBytes(), stage);
+}
+
+void EncodingBudget::check(const Automaton &ta,
+                           const std::string &stage) const {
+  check(ta.states.size(),
+        ta.states.size() * sizeof(State) +
+            ta.transitions.size() * sizeof(Transition),
+        stage);
+}
+
+void EncodingBudget::check(double num_states, double memory_bytes,
+                           const std::string &stage) const {
+  std::ostringstream msg;
+  if (max_states > 0 && num_states > max_states) {
+    msg << "encoding budget exceeded at " << stage << ": " << num_states
+        << " states, limit is " << max_states;
+  } else if (max_memory_bytes > 0 && memory_bytes > max_memory_bytes) {
+    msg << "encoding budget exceeded at " << stage << ": "
+        << memory_bytes / (1024 * 1024) << " MB, limit is "
+        << max_memory_bytes / (1024 * 1024) << " MB";
+  } else {
+    return;
+  }
+  throw BudgetExceededError(msg.str());
+}
@@ -0,0 +1,139 @@
+/** \file
+ * Size prediction of direct encodings and budgets to limit their size.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+#pragma once
+#include "../timed-automata/timed_automata.h"
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace taptenc {
+/**
+ * Predicted size of a direct encoding, per timeline in plan order.
+ *
+ * Counts are stored as floating point numbers, as exploding encodings
+ * exceed any integer type long before they can be built.
+ *
+ * Constraints that restrict the platform to some target states are assumed
+ * to keep the same fraction of states in each copy.
+ */
+struct encodingEstimate {
+  /** Number of states of each timeline. */
+  ::std::vector<double> states;
+  /** Number of transitions within each timeline. */
+  ::std::vector<double> transitions;
+  /** Number of transitions from each timeline to the next one. */
+  ::std::vector<double> outgoing;
+
+  encodingEstimate() = default;
+  /**
+   * Predicts the base timelines of a plan with a platform model.
+   *
+   * @param num_timelines number of plan actions (including the start)
+   * @param platform platform model TA
+   */
+  encodingEstimate(size_t num_timelines, const Automaton &platform);
+
+  /**
+   * Accounts for a window of timeline copies created by a constraint.
+   *
+   * The window copies the timelines of \a orig within a range of positions.
+   * \a orig may be this estimate.
+   *
+   * @param orig timelines that are copied
+   * @param first position of the first timeline of the window
+   * @param last position of the last timeline of the window
+   * @param fraction fraction of the states that the copies keep
+   */
+  void addWindow(const encodingEstimate &orig, size_t first, size_t last,
+                 double fraction = 1);
+  /**
+   * Accounts for states removed from all timelines within a range.
+   *
+   * @param first position of the first timeline of the range
+   * @param last position of the last timeline of the range
+   * @param fraction fraction of the states that are kept
+   */
+  void restrict(size_t first, size_t last, double fraction);
+  /**
+   * Predicts the merge of two encodings of the same plan (see
+   * DirectEncoder::mergeEncodings()).
+   *
+   * @param other encoding to merge with
+   * @return prediction of the merged encoding
+   */
+  encodingEstimate merge(const encodingEstimate &other) const;
+
+  /** @return predicted number of states (including the query state) */
+  double numStates() const;
+  /** @return predicted number of transitions */
+  double numTransitions() const;
+  /**
+   * @return predicted memory in bytes that the states and transitions of the
+   *         final automaton occupy
+   */
+  double memoryBytes() const;
+};
+typedef struct encodingEstimate EncodingEstimate;
+
+/**
+ * Thrown if an encoding exceeds its budget.
+ */
+class BudgetExceededError : public ::std::runtime_error {
+public:
+  using ::std::runtime_error::runtime_error;
+};
+
+/**
+ * Limits the size of encodings that are built.
+ */
+class EncodingBudget {
+public:
+  /**
+   * Creates a budget.
+   *
+   * @param max_states maximum number of states, 0 for no limit
+   * @param max_memory_bytes maximum memory for states and transitions, 0 for
+   *                         no limit
+   */
+  explicit EncodingBudget(double max_states = 0, double max_memory_bytes = 0);
+  /**
+   * Creates a budget from the environment variables TAPTENC_MAX_STATES and
+   * TAPTENC_MAX_MEMORY_MB, unset variables do not limit the encoding.
+   *
+   * @return budget configured by the environment
+   */
+  static EncodingBudget fromEnv();
+
+  /**
+   * Checks a predicted or measured (see DirectEncoder::measure()) encoding
+   * against the budget.
+   *
+   * @param est size of the encoding
+   * @param stage description of the encoding step for the diagnostic
+   * @throw BudgetExceededError if \a est exceeds the budget
+   */
+  void check(const EncodingEstimate &est, const ::std::string &stage) const;
+  /**
+   * Checks a built automaton against the budget.
+   *
+   * @param ta automaton to check
+   * @param stage description of the encoding step for the diagnostic
+   * @throw BudgetExceededError if \a ta exceeds the budget
+   */
+  void check(const Automaton &ta, const ::std::string &stage) const;
+
+  /** @return true iff the budget limits anything */
+  bool limited() const { return max_states > 0 || max_memory_bytes > 0; }
+
+private:
+  double max_states;
+  double max_memory_bytes;
+
+  void check(double num_states, double memory_bytes,
+             const ::std::string &stage) const;
+};
+} // end namespace taptenc
@@ -6,26 +6,118 @@
  */
 #include "filter.h"
 #include "../constants.h"
+#include "../timed-automata/state_id.h"
 #include "../timed-automata/timed_automata.h"
 #include "../utils.h"
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using namespace taptenc;
 
+namespace {
+/** Positions of states, grouped by the base part of their ids. */
+typedef std::unordered_map<Symbol, std::vector<size_t>> BasePositions;
+
+BasePositions basePositions(const std::vector<State> &states) {
+  BasePositions res;
+  for (size_t i = 0; i < states.size(); i++) {
+    res[StateId::of(states[i].id).base].push_back(i);
+  }
+  return res;
+}
+
+/**
+ * Finds the first state that matches a filter state.
+ *
+ * @param states states to search in
+ * @param positions positions of \a states grouped by base part
+ * @param prefix prefix the matching state id has to start with
+ * @param suffix id of the filter state
+ * @return first state matching \a suffix (see Filter::matchesFilter()) or
+ *         states.end() if there is none
+ */
+std::vector<State>::const_iterator
+firstMatch(const std::vector<State> &states, const BasePositions &positions,
+           const Symbol &prefix, const Symbol &suffix) {
+  if (StateId::of(suffix).base.empty()) {
+    return std::find_if(states.begin(), states.end(),
+                        [&prefix, &suffix](const State &s) {
+                          return Filter::matchesFilter(s.id, prefix, suffix);
+                        });
+  }
+  auto search = positions.find(StateId::of(suffix).base);
+  if (search != positions.end()) {
+    for (const auto &pos : search->second) {
+      if (Filter::matchesFilter(states[pos].id, prefix, suffix)) {
+        return states.begin() + pos;
+      }
+    }
+  }
+  return states.end();
+}
+} // end anonymous namespace
+
 Filter::Filter(std::vector<State> arg_filter, bool arg_invert_effect) {
   invert_effect = arg_invert_effect;
   filter = arg_filter;
+  for (const auto &f_state : filter) {
+    const Symbol &base = StateId::of(f_state.id).base;
+    if (base.empty()) {
+      unrestricted.push_back(f_state.id);
+    } else {
+      sieve[base].push_back(f_state.id);
+    }
+  }
 }
 
-bool Filter::isFilterEndIt(const std::vector<State>::const_iterator &it) const {
-  bool res = it == filter.end();
-  if (invert_effect) {
-    res = !res;
+bool Filter::matchesSieve(const Symbol &id, std::string_view prefix) const {
+  if (!hasPrefix(id.str(), prefix)) {
+    return false;
   }
-  return res;
+  auto search = sieve.find(StateId::of(id).base);
+  if (search != sieve.end()) {
+    for (const auto &suffix : search->second) {
+      if (id == suffix || hasSuffix(id.str(), suffix.str())) {
+        return true;
+      }
+    }
+  }
+  for (const auto &suffix : unrestricted) {
+    if (id == suffix || hasSuffix(id.str(), suffix.str())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Filter::matchesEntryState(const TlEntry &entry, size_t pos) const {
+  const SharedAutomaton &shared = entry.getShared();
+  if (!entry.isRenamed()) {
+    return matchesSieve(shared.ta.states[pos].id, "");
+  }
+  std::string_view head = entry.getPrefix().str();
+  if (!unrestricted.empty() ||
+      (!head.empty() && head.back() != constants::BASE_SEP)) {
+    // the base part of the copied id may differ from the shared one
+    return matchesSieve(entry.stateId(pos), "");
+  }
+  const Symbol &base = shared.bases[pos];
+  auto search = sieve.find(base);
+  if (search == sieve.end()) {
+    return false;
+  }
+  for (const auto &suffix : search->second) {
+    // both ids end with the base part, so only the heads are compared
+    std::string_view suffix_head = suffix.str();
+    suffix_head.remove_suffix(base.size());
+    if (hasSuffix(head, suffix_head)) {
+      return true;
+    }
+  }
+  return false;
 }
 
 std::vector<State> Filter::getFilter() const { return filter; }
@@ -41,36 +133,31 @@ std::string Filter::stripPrefix(std::string name, std::string prefix) {
   return name;
 }
 
-bool Filter::hasSuffix(std::string name, std::string suffix) {
+bool Filter::hasSuffix(std::string_view name, std::string_view suffix) {
   if (name.size() >= suffix.size()) {
-    return name.substr(name.size() - suffix.size(), suffix.size()) == suffix;
+    return name.compare(name.size() - suffix.size(), suffix.size(), suffix) ==
+           0;
   } else {
     return false;
   }
 }
 
-bool Filter::hasPrefix(std::string name, std::string prefix) {
+bool Filter::hasPrefix(std::string_view name, std::string_view prefix) {
   if (name.size() >= prefix.size()) {
-    return name.substr(0, prefix.size()) == prefix;
+    return name.compare(0, prefix.size(), prefix) == 0;
   } else {
     return false;
   }
 }
 
-bool Filter::matchesFilter(std::string name, std::string prefix,
-                           std::string suffix) {
-  if (not(hasPrefix(name, prefix) && hasSuffix(name, suffix))) {
+bool Filter::matchesFilter(const Symbol &name, const Symbol &prefix,
+                           const Symbol &suffix) {
+  if (not(hasPrefix(name.str(), prefix.str()) &&
+          (name == suffix || hasSuffix(name.str(), suffix.str())))) {
     return false;
   } else {
-    std::string base_name =
-        (name.find(constants::BASE_SEP) == std::string::npos)
-            ? name
-            : getSuffix(name, constants::BASE_SEP);
-    std::string base_suffix =
-        (suffix.find(constants::BASE_SEP) == std::string::npos)
-            ? suffix
-            : getSuffix(suffix, constants::BASE_SEP);
-    return base_suffix == "" || base_name == base_suffix;
+    const Symbol &base_suffix = StateId::of(suffix).base;
+    return base_suffix.empty() || StateId::of(name).base == base_suffix;
   }
 }
 
@@ -97,35 +184,25 @@ std::string Filter::getPrefix(std::string name, char marker) {
 }
 
 void Filter::filterTransitionsInPlace(std::vector<Transition> &trans,
-                                      std::string prefix,
+                                      const Symbol &prefix,
                                       bool filter_source) const {
-  trans.erase(std::remove_if(
-                  trans.begin(), trans.end(),
-                  [filter_source, prefix, this](Transition &t) {
-                    std::string id =
-                        ((filter_source) ? t.source_id : t.dest_id);
-                    bool res =
-                        hasPrefix(id, prefix) &&
-                        isFilterEndIt(std::find_if(
-                            filter.begin(), filter.end(),
-                            [id, filter_source, prefix, this](const State &s) {
-                              return Filter::matchesFilter(id, prefix, s.id);
-                            }));
-                    return res;
-                  }),
-              trans.end());
+  trans.erase(
+      std::remove_if(trans.begin(), trans.end(),
+                     [filter_source, &prefix, this](Transition &t) {
+                       const Symbol &id =
+                           ((filter_source) ? t.source_id : t.dest_id);
+                       return hasPrefix(id.str(), prefix.str()) &&
+                              isSievedOut(matchesSieve(id, prefix.str()));
+                     }),
+      trans.end());
 }
 
 void Filter::filterAutomatonInPlace(Automaton &source,
-                                    std::string prefix) const {
+                                    const Symbol &prefix) const {
   source.states.erase(std::remove_if(source.states.begin(), source.states.end(),
-                                     [prefix, this](State &s) {
-                                       return isFilterEndIt(std::find_if(
-                                           filter.begin(), filter.end(),
-                                           [prefix, s, this](const State &f_s) {
-                                             return Filter::matchesFilter(
-                                                 s.id, prefix, f_s.id);
-                                           }));
+                                     [&prefix, this](State &s) {
+                                       return isSievedOut(
+                                           matchesSieve(s.id, prefix.str()));
                                      }),
                       source.states.end());
   filterTransitionsInPlace(source.transitions, prefix, true);
@@ -135,32 +212,26 @@ void Filter::filterAutomatonInPlace(Automaton &source,
 Automaton Filter::copyAutomaton(const Automaton &source, std::string ta_prefix,
                                 bool strip_constraints) {
   std::vector<State> res_states;
+  std::unordered_map<Symbol, size_t> res_bases;
   std::vector<Transition> res_transitions;
   for (const auto &s : source.states) {
+    const Symbol &base = StateId::of(s.id).base;
+    res_bases.emplace(base, res_states.size());
     if (strip_constraints) {
       res_states.push_back(
-          State(ta_prefix + Filter::getSuffix(s.id, constants::BASE_SEP),
-                TrueCC(), s.urgent, s.initial));
+          State(ta_prefix + base, TrueCC(), s.urgent, s.initial));
     } else {
       res_states.push_back(
-          State(ta_prefix + Filter::getSuffix(s.id, constants::BASE_SEP),
-                *s.inv.get(), s.urgent, s.initial));
+          State(ta_prefix + base, *s.inv.get(), s.urgent, s.initial));
     }
   }
   for (const auto &trans : source.transitions) {
-    auto source = std::find_if(res_states.begin(), res_states.end(),
-                               [trans, ta_prefix](const State &s) {
-                                 return Filter::matchesFilter(
-                                     trans.source_id, "",
-                                     Filter::stripPrefix(s.id, ta_prefix));
-                               });
-    auto dest = std::find_if(res_states.begin(), res_states.end(),
-                             [trans, ta_prefix](const State &s) {
-                               return Filter::matchesFilter(
-                                   trans.dest_id, "",
-                                   Filter::stripPrefix(s.id, ta_prefix));
-                             });
-    if (source != res_states.end() && dest != res_states.end()) {
+    // copies only differ in the part before the base id
+    auto source_base = res_bases.find(StateId::of(trans.source_id).base);
+    auto dest_base = res_bases.find(StateId::of(trans.dest_id).base);
+    if (source_base != res_bases.end() && dest_base != res_bases.end()) {
+      auto source = res_states.begin() + source_base->second;
+      auto dest = res_states.begin() + dest_base->second;
       if (strip_constraints) {
         res_transitions.push_back(Transition(source->id, dest->id, trans.action,
                                              TrueCC(), {}, trans.sync, true));
@@ -173,7 +244,7 @@ Automaton Filter::copyAutomaton(const Automaton &source, std::string ta_prefix,
   }
   Automaton res(res_states, res_transitions, ta_prefix, false);
   if (!strip_constraints) {
-    res.clocks.insert(source.clocks.begin(), source.clocks.end());
+    res.clocks |= source.clocks;
     res.bool_vars.insert(res.bool_vars.end(), source.bool_vars.begin(),
                          source.bool_vars.end());
   }
@@ -182,25 +253,24 @@ Automaton Filter::copyAutomaton(const Automaton &source, std::string ta_prefix,
 
 Automaton Filter::filterAutomaton(const Automaton &source,
                                   std::string ta_prefix,
-                                  std::string filter_prefix,
+                                  const Symbol &filter_prefix,
                                   bool strip_constraints) const {
   std::vector<State> res_states;
+  std::unordered_map<Symbol, size_t> res_bases;
   std::vector<Transition> res_transitions;
+  BasePositions source_positions = basePositions(source.states);
   for (const auto &f_state : filter) {
-    auto search = std::find_if(source.states.begin(), source.states.end(),
-                               [f_state, filter_prefix, this](const State &s) {
-                                 return Filter::matchesFilter(
-                                     s.id, filter_prefix, f_state.id);
-                               });
+    auto search = firstMatch(source.states, source_positions, filter_prefix,
+                             f_state.id);
     if (search != source.states.end()) {
+      const Symbol &base = StateId::of(search->id).base;
+      res_bases.emplace(base, res_states.size());
       if (strip_constraints) {
-        res_states.push_back(State(
-            ta_prefix + Filter::getSuffix(search->id, constants::BASE_SEP),
-            TrueCC(), search->urgent, search->initial));
+        res_states.push_back(State(ta_prefix + base, TrueCC(), search->urgent,
+                                   search->initial));
       } else {
-        res_states.push_back(State(
-            ta_prefix + Filter::getSuffix(search->id, constants::BASE_SEP),
-            *search->inv.get(), search->urgent, search->initial));
+        res_states.push_back(State(ta_prefix + base, *search->inv.get(),
+                                   search->urgent, search->initial));
       }
     } else {
       // std::cout << "Filter filterAutomaton: filter state not found (id "
@@ -208,19 +278,16 @@ Automaton Filter::filterAutomaton(const Automaton &source,
     }
   }
   for (const auto &trans : source.transitions) {
-    auto source = std::find_if(
-        res_states.begin(), res_states.end(),
-        [trans, this, filter_prefix, ta_prefix](const State &s) {
-          return Filter::matchesFilter(trans.source_id, filter_prefix,
-                                       Filter::stripPrefix(s.id, ta_prefix));
-        });
-    auto dest = std::find_if(
-        res_states.begin(), res_states.end(),
-        [trans, this, filter_prefix, ta_prefix](const State &s) {
-          return Filter::matchesFilter(trans.dest_id, filter_prefix,
-                                       Filter::stripPrefix(s.id, ta_prefix));
-        });
-    if (source != res_states.end() && dest != res_states.end()) {
+    if (!hasPrefix(trans.source_id.str(), filter_prefix.str()) ||
+        !hasPrefix(trans.dest_id.str(), filter_prefix.str())) {
+      continue;
+    }
+    // copies only differ in the part before the base id
+    auto source_base = res_bases.find(StateId::of(trans.source_id).base);
+    auto dest_base = res_bases.find(StateId::of(trans.dest_id).base);
+    if (source_base != res_bases.end() && dest_base != res_bases.end()) {
+      auto source = res_states.begin() + source_base->second;
+      auto dest = res_states.begin() + dest_base->second;
       if (strip_constraints) {
         res_transitions.push_back(Transition(source->id, dest->id, trans.action,
                                              TrueCC(), {}, trans.sync, true));
@@ -233,25 +300,45 @@ Automaton Filter::filterAutomaton(const Automaton &source,
   }
   Automaton res(res_states, res_transitions, ta_prefix, false);
   if (!strip_constraints) {
-    res.clocks.insert(source.clocks.begin(), source.clocks.end());
+    res.clocks |= source.clocks;
     res.bool_vars.insert(res.bool_vars.end(), source.bool_vars.begin(),
                          source.bool_vars.end());
   }
   return res;
 }
 
+void Filter::filterEntryInPlace(TlEntry &entry) const {
+  for (size_t i = 0; i < entry.sharedSize(); i++) {
+    if (!entry.isActive(i)) {
+      continue;
+    }
+    if (isSievedOut(matchesEntryState(entry, i))) {
+      entry.removeState(i);
+    }
+  }
+}
+
+TlEntry Filter::filterEntry(const TlEntry &source,
+                            const Symbol &ta_prefix) const {
+  TlEntry res = source.rename(ta_prefix);
+  for (size_t i = 0; i < source.sharedSize(); i++) {
+    if (!source.isActive(i)) {
+      continue;
+    }
+    if (!matchesEntryState(source, i)) {
+      res.removeState(i);
+    }
+  }
+  return res;
+}
+
 void Filter::addToTransitions(std::vector<Transition> &trans,
                               const ClockConstraint &guard,
-                              const update_t &update, std::string prefix,
+                              const update_t &update, const Symbol &prefix,
                               bool filter_source) const {
   for (auto &tr : trans) {
-    auto search = std::find_if(
-        filter.begin(), filter.end(),
-        [filter_source, tr, prefix, this](const State &s) {
-          return Filter::matchesFilter(
-              ((filter_source) ? tr.source_id : tr.dest_id), prefix, s.id);
-        });
-    if (!isFilterEndIt(search)) {
+    if (!isSievedOut(matchesSieve(
+            ((filter_source) ? tr.source_id : tr.dest_id), prefix.str()))) {
       tr.guard = addConstraint(*tr.guard.get(), guard);
       tr.update = addUpdate(tr.update, update);
     }
@@ -259,11 +346,9 @@ void Filter::addToTransitions(std::vector<Transition> &trans,
 }
 Filter Filter::updateFilter(const Automaton &ta) const {
   std::vector<State> update_filter;
+  BasePositions ta_positions = basePositions(ta.states);
   for (const auto &f_state : filter) {
-    auto search = std::find_if(
-        ta.states.begin(), ta.states.end(), [f_state, this](const State &s) {
-          return Filter::matchesFilter(s.id, "", f_state.id);
-        });
+    auto search = firstMatch(ta.states, ta_positions, Symbol(), f_state.id);
     if (search != ta.states.end()) {
       update_filter.push_back(*search);
     } else {
@@ -277,19 +362,12 @@ Filter Filter::updateFilter(const Automaton &ta) const {
 Filter Filter::reverseFilter(const Automaton &ta) const {
   std::vector<State> reverse_filter;
   for (const auto &ta_state : ta.states) {
-    auto search =
-        std::find_if(filter.begin(), filter.end(), [ta_state](const State &s) {
-          return Filter::matchesFilter(ta_state.id, "", s.id);
-        });
-    if (search == filter.end()) {
+    if (!matchesSieve(ta_state.id, "")) {
       reverse_filter.push_back(ta_state);
     }
   }
   return Filter(reverse_filter);
 }
-bool Filter::matchesId(const std::string id) const {
-  return !isFilterEndIt(
-      std::find_if(filter.begin(), filter.end(), [id](const State &s) {
-        return Filter::matchesFilter(id, "", s.id);
-      }));
+bool Filter::matchesId(const Symbol &id) const {
+  return !isSievedOut(matchesSieve(id, ""));
 }
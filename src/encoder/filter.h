@@ -6,6 +6,10 @@
  */
 #pragma once
 #include "../timed-automata/timed_automata.h"
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace taptenc {
 /**
@@ -15,15 +19,46 @@ class Filter {
 private:
   /** Sieve to apply to the states/transition sources/destinations. */
   ::std::vector<State> filter;
+  /**
+   * Ids of the states in \a filter, grouped by their base part (see StateId).
+   *
+   * A filter state only matches ids with the same base part, so each id has
+   * to be compared against a single group instead of the whole filter.
+   */
+  ::std::unordered_map<Symbol, ::std::vector<Symbol>> sieve;
+  /** Ids of the states in \a filter that have an empty base part. */
+  ::std::vector<Symbol> unrestricted;
   /**
    * If true, keeps the sieved out content instead of the sieved through stuff.
    * */
   bool invert_effect = false;
   /**
-   * Wrapper to check queries in \a filter. Inverts the output if \a
+   * Checks whether an id matches some state of the filter (see
+   * matchesFilter()), ignoring \a invert_effect.
+   *
+   * @param id state id to check
+   * @param prefix prefix \a id has to start with
+   * @return true, iff some filter state matches \a id
+   */
+  bool matchesSieve(const Symbol &id, ::std::string_view prefix) const;
+  /**
+   * Checks whether a state of a timeline copy matches the filter, without
+   * building the id of the state.
+   *
+   * @param entry timeline copy
+   * @param pos position of the state in the shared automaton of \a entry
+   * @return true, iff some filter state matches the state, ignoring
+   *         \a invert_effect
+   */
+  bool matchesEntryState(const TlEntry &entry, ::std::size_t pos) const;
+  /**
+   * Decides whether an id gets sieved out. Inverts the output if \a
    * invert_effect is true.
+   *
+   * @param matches true, iff the id matches the filter
+   * @return true, iff the id should be removed
    */
-  bool isFilterEndIt(const ::std::vector<State>::const_iterator &it) const;
+  bool isSievedOut(bool matches) const { return matches == invert_effect; }
   /**
    * Checks if a string has a specified suffix.
    *
@@ -31,7 +66,7 @@ private:
    * @param suffix suffix to search in \a name
    * @return true, iff \a suffix is a suffix of \a name
    */
-  static bool hasSuffix(::std::string name, ::std::string suffix);
+  static bool hasSuffix(::std::string_view name, ::std::string_view suffix);
   /**
    * Checks if a string has a specified prefix.
    *
@@ -39,7 +74,7 @@ private:
    * @param prefix prefix to search in \a name
    * @return true, iff \a prefix is a prefix of \a name
    */
-  static bool hasPrefix(::std::string name, ::std::string prefix);
+  static bool hasPrefix(::std::string_view name, ::std::string_view prefix);
 
 public:
   /**
@@ -51,14 +86,17 @@ public:
    */
   Filter(std::vector<State> input, bool arg_invert_effect = false);
   /**
-   * Checks if a prefix and suffix is contained in a string.
+   * Checks if a prefix and suffix is contained in a state id.
+   *
+   * Additionally the base part (see StateId) of \a name and \a suffix have to
+   * match, unless the base part of \a suffix is empty.
    *
-   * @param name string to check for prefix and suffix
+   * @param name state id to check for prefix and suffix
    * @param prefix prefix to search in \a name
    * @param suffix suffix to search in \a name
    */
-  static bool matchesFilter(::std::string name, ::std::string prefix,
-                            ::std::string suffix);
+  static bool matchesFilter(const Symbol &name, const Symbol &prefix,
+                            const Symbol &suffix);
   /**
    * Removes a prefix from a string.
    *
@@ -103,7 +141,7 @@ public:
    *                      \a trans, else filter the dest ids
    */
   void filterTransitionsInPlace(::std::vector<Transition> &trans,
-                                ::std::string prefix, bool filter_source) const;
+                                const Symbol &prefix, bool filter_source) const;
 
   /**
    * Removes all states form an automaton that hava a certain prefix and match
@@ -112,7 +150,7 @@ public:
    * @param source automaton to filter states of
    * @param prefix prefix to only filter out states matchin the prefix
    */
-  void filterAutomatonInPlace(Automaton &source, ::std::string prefix) const;
+  void filterAutomatonInPlace(Automaton &source, const Symbol &prefix) const;
 
   /**
    * Creates a copy of an automaton.
@@ -140,9 +178,30 @@ public:
    * @return Automaton copy with filtered states
    */
   Automaton filterAutomaton(const Automaton &source, ::std::string ta_prefix,
-                            ::std::string filter_prefix = "",
+                            const Symbol &filter_prefix = Symbol(),
                             bool strip_constraints = true) const;
 
+  /**
+   * Removes all states from a timeline copy that do not match the filter.
+   *
+   * Counterpart of filterAutomatonInPlace() for TlEntry copies.
+   *
+   * @param entry copy to filter states of
+   */
+  void filterEntryInPlace(TlEntry &entry) const;
+
+  /**
+   * Creates a renamed timeline copy with filtered states.
+   *
+   * Counterpart of filterAutomaton() for TlEntry copies, the result shares
+   * its automaton with \a source and has no outgoing transitions.
+   *
+   * @param source copy to copy
+   * @param ta_prefix prefix for the new copy
+   * @return copy with filtered states
+   */
+  TlEntry filterEntry(const TlEntry &source, const Symbol &ta_prefix) const;
+
   /**
    * Adds guards and updates to transitions matching a filter.
    *
@@ -155,7 +214,7 @@ public:
    */
   void addToTransitions(::std::vector<Transition> &trans,
                         const ClockConstraint &guard, const update_t &update,
-                        ::std::string prefix, bool filter_source) const;
+                        const Symbol &prefix, bool filter_source) const;
   /**
    * Gets a copy of the filter states.
    */
@@ -187,6 +246,6 @@ public:
    * @param id state id
    * @return true, if id matches the filter, else return false
    */
-  bool matchesId(const std::string id) const;
+  bool matchesId(const Symbol &id) const;
 };
 } // end namespace taptenc
@@ -3,11 +3,13 @@
 #include "constants.h"
 #include "encoder_utils.h"
 #include "filter.h"
+#include "state_id.h"
 #include "timed_automata.h"
 #include "utils.h"
 #include <algorithm>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -27,9 +29,7 @@ void PlanOrderedTLs::printTLs() const {
     }
   }
   for (const auto &entry : *(tls.get())) {
-    const auto &search =
-        std::find(pa_order.get()->begin(), pa_order.get()->end(), entry.first);
-    if (search == pa_order.get()->end()) {
+    if (planActionIndex(entry.first) == npos) {
       std::cout << "extra TL: " << entry.first << std::endl;
       for (const auto &ta : entry.second) {
         std::cout << "\t TA: " << ta.first << std::endl;
@@ -43,41 +43,63 @@ OrigMap PlanOrderedTLs::createOrigMapping(std::string prefix) const {
   OrigMap res;
   for (const auto &curr_tl : *(tls.get())) {
     for (const auto &tl_entry : curr_tl.second) {
-      if (tl_entry.second.ta.prefix == constants::QUERY) {
+      const Symbol &entry_prefix = tl_entry.second.getPrefix();
+      if (entry_prefix == constants::QUERY) {
         continue;
       }
       std::string ta_prefix =
-          prefix == ""
-              ? tl_entry.second.ta.prefix
-              : encoderutils::addToPrefix(tl_entry.second.ta.prefix, prefix);
-      res[ta_prefix] = tl_entry.second.ta.prefix;
+          prefix == "" ? entry_prefix.str()
+                       : encoderutils::addToPrefix(entry_prefix, prefix);
+      res[ta_prefix] = entry_prefix;
     }
   }
   return res;
 }
 
+void PlanOrderedTLs::addPlanAction(const Symbol &pa) {
+  pa_pos.emplace(pa, pa_order.get()->size());
+  pa_order.get()->push_back(pa);
+}
+
+std::size_t PlanOrderedTLs::planActionIndex(const Symbol &pa) const {
+  auto search = pa_pos.find(pa);
+  if (search == pa_pos.end()) {
+    return npos;
+  }
+  return search->second;
+}
+
 PlanOrderedTLs PlanOrderedTLs::createWindow(std::string start_pa,
                                             std::string end_pa,
                                             const Filter &target_filter,
                                             std::string prefix_add) const {
-  PlanOrderedTLs new_window;
-  auto start_pa_entry =
-      std::find(pa_order.get()->begin(), pa_order.get()->end(), start_pa);
-  if (start_pa_entry == pa_order.get()->end()) {
+  std::size_t context_start = planActionIndex(start_pa);
+  if (context_start == npos) {
     std::cout << "PlanOrderedTLs createWindow: could not find start pa "
               << start_pa << std::endl;
-    return new_window;
+    return PlanOrderedTLs();
   }
-  auto end_pa_entry = std::find(start_pa_entry, pa_order.get()->end(), end_pa);
-  if (end_pa_entry == pa_order.get()->end()) {
+  std::size_t context_end = planActionIndex(end_pa);
+  if (context_end == npos || context_end < context_start) {
     std::cout << "PlanOrderedTLs createWindow: could not find end pa " << end_pa
               << std::endl;
     std::cout << "PlanOrderedTLs createWindow: prefix add" << prefix_add
               << std::endl;
+    return PlanOrderedTLs();
+  }
+  return createWindow(context_start, context_end, target_filter, prefix_add);
+}
+
+PlanOrderedTLs PlanOrderedTLs::createWindow(std::size_t context_start,
+                                            std::size_t context_end,
+                                            const Filter &target_filter,
+                                            std::string prefix_add) const {
+  PlanOrderedTLs new_window;
+  if (context_start > context_end || context_end >= pa_order.get()->size()) {
+    std::cout << "PlanOrderedTLs createWindow: invalid window "
+              << context_start << "," << context_end << std::endl;
     return new_window;
   }
-  std::size_t context_start = start_pa_entry - pa_order.get()->begin();
-  std::size_t context_end = end_pa_entry - pa_order.get()->begin();
   auto curr_tl = tls.get()->find(*(pa_order.get()->begin() + context_start));
   std::string op_name =
       Filter::getPrefix(prefix_add, constants::CONSTRAINT_SEP);
@@ -89,10 +111,9 @@ PlanOrderedTLs PlanOrderedTLs::createWindow(std::string start_pa,
       TimeLine new_tls;
       // copy all original tls
       for (auto &tl_entry : curr_tl->second) {
-        std::string ta_prefix =
-            encoderutils::addToPrefix(tl_entry.second.ta.prefix, prefix_add);
-        Automaton copy_ta = target_filter.filterAutomaton(tl_entry.second.ta,
-                                                          ta_prefix, "", false);
+        std::string ta_prefix = encoderutils::addToPrefix(
+            tl_entry.second.getPrefix(), prefix_add);
+        TlEntry copy_ta = target_filter.filterEntry(tl_entry.second, ta_prefix);
         std::vector<Transition> cp_to_other_cp;
         // also copy the transitions connecting different orig TLs
         if (tls_copied + context_start < context_end) {
@@ -104,8 +125,8 @@ PlanOrderedTLs PlanOrderedTLs::createWindow(std::string start_pa,
                                                     op_name, true, false);
         }
         target_filter.filterTransitionsInPlace(cp_to_other_cp, "", true);
-        auto emp = new_tls.emplace(
-            std::make_pair(ta_prefix, TlEntry(copy_ta, cp_to_other_cp)));
+        copy_ta.trans_out = std::move(cp_to_other_cp);
+        auto emp = new_tls.emplace(std::make_pair(ta_prefix, copy_ta));
         if (emp.second == false) {
           std::cout << "PlanOrderedTLs createWindow: failed to add prefix: "
                     << prefix_add << std::endl;
@@ -113,8 +134,7 @@ PlanOrderedTLs PlanOrderedTLs::createWindow(std::string start_pa,
       }
       // insert the new tls and also save them in the curr_window
       for (const auto &new_tl : new_tls) {
-        (*new_window.tls
-              .get())[Filter::getPrefix(new_tl.first, constants::TL_SEP)]
+        (*new_window.tls.get())[StateId::of(new_tl.first).plan_action]
             .emplace(new_tl);
       }
       tls_copied++;
@@ -136,33 +156,46 @@ PlanOrderedTLs PlanOrderedTLs::createWindow(std::string start_pa,
               << *(pa_order.get()->begin() + context_start) << std::endl;
   }
   for (const auto &pa : *(pa_order.get())) {
-    new_window.pa_order.get()->push_back(pa);
+    new_window.addPlanAction(pa);
   }
   return new_window;
 }
 
 void PlanOrderedTLs::createTransitionsToWindow(
     const Automaton &base_ta, TimeLines &dest_tls,
-    const std::unordered_map<std::string, std::string> &map_to_orig,
+    const OrigMap &map_to_orig,
     std::string start_pa, std::string end_pa, const Filter &target_filter,
     const ClockConstraint &guard, const update_t &update, bool add_succ_trans) {
-  auto start_pa_entry =
-      std::find(pa_order.get()->begin(), pa_order.get()->end(), start_pa);
-  if (start_pa_entry == pa_order.get()->end()) {
+  std::size_t context_start = planActionIndex(start_pa);
+  if (context_start == npos) {
     std::cout << "PlanOrderedTLs createTransitionsBetweenWindows: could not "
                  "find start pa "
               << start_pa << std::endl;
     return;
   }
-  auto end_pa_entry = std::find(start_pa_entry, pa_order.get()->end(), end_pa);
-  if (end_pa_entry == pa_order.get()->end()) {
+  std::size_t context_end = planActionIndex(end_pa);
+  if (context_end == npos || context_end < context_start) {
     std::cout << "PlanOrderedTLs createTransitionsBetweenWindows: could not "
                  "find end pa "
               << end_pa << std::endl;
     return;
   }
-  std::size_t context_start = start_pa_entry - pa_order.get()->begin();
-  std::size_t context_end = end_pa_entry - pa_order.get()->begin();
+  createTransitionsToWindow(base_ta, dest_tls, map_to_orig, context_start,
+                            context_end, target_filter, guard, update,
+                            add_succ_trans);
+}
+
+void PlanOrderedTLs::createTransitionsToWindow(
+    const Automaton &base_ta, TimeLines &dest_tls, const OrigMap &map_to_orig,
+    std::size_t context_start, std::size_t context_end,
+    const Filter &target_filter, const ClockConstraint &guard,
+    const update_t &update, bool add_succ_trans) {
+  if (context_start > context_end || context_end >= pa_order.get()->size()) {
+    std::cout << "PlanOrderedTLs createTransitionsBetweenWindows: invalid "
+                 "window "
+              << context_start << "," << context_end << std::endl;
+    return;
+  }
   auto source_tl = tls.get()->find(*(pa_order.get()->begin() + context_start));
   int i = 0;
   while (context_start + i <= context_end && source_tl != tls.get()->end()) {
@@ -172,8 +205,8 @@ void PlanOrderedTLs::createTransitionsToWindow(
       for (auto &source_entry : source_tl->second) {
         auto dest_entry = std::find_if(
             dest_tl->second.begin(), dest_tl->second.end(),
-            [source_entry,
-             map_to_orig](const std::pair<std::string, TlEntry> &d) {
+            [&source_entry,
+             &map_to_orig](const std::pair<const Symbol, TlEntry> &d) {
               auto orig_source_entry = map_to_orig.find(source_entry.first);
               auto orig_dest_entry = map_to_orig.find(d.first);
               return orig_source_entry != map_to_orig.end() &&
@@ -181,15 +214,15 @@ void PlanOrderedTLs::createTransitionsToWindow(
                      orig_source_entry->second == orig_dest_entry->second;
             });
         if (dest_entry != dest_tl->second.end()) {
-          std::vector<Transition> res;
-          res = encoderutils::createCopyTransitionsBetweenTAs(
-              source_entry.second.ta, dest_entry->second.ta,
-              dest_entry->second.ta.states, guard, update, "");
+          std::vector<Transition> res =
+              encoderutils::createCopyTransitionsBetweenTAs(
+                  source_entry.second, dest_entry->second, dest_entry->second,
+                  guard, update, "");
           if (add_succ_trans) {
             std::vector<Transition> res_succ =
                 encoderutils::createSuccessorTransitionsBetweenTAs(
-                    base_ta, source_entry.second.ta, dest_entry->second.ta,
-                    source_entry.second.ta.states, guard, update);
+                    base_ta, source_entry.second, dest_entry->second,
+                    source_entry.second, guard, update);
             target_filter.filterTransitionsInPlace(res, dest_entry->first,
                                                    false);
             target_filter.filterTransitionsInPlace(res_succ, dest_entry->first,
@@ -243,22 +276,12 @@ void PlanOrderedTLs::addOutgoingTransOfOrigTL(const TimeLine &orig_tl,
       const auto &orig_entry = orig_tl.find(orig_name->second);
       if (orig_entry != orig_tl.end()) {
         for (const auto &tr : orig_entry->second.trans_out) {
-          if (Filter::getPrefix(tr.source_id, constants::TL_SEP) !=
-              Filter::getPrefix(tr.dest_id, constants::TL_SEP)) {
-            std::string source_base_name =
-                Filter::getSuffix(tr.source_id, constants::BASE_SEP);
-            const auto &source_state = std::find_if(
-                tl_entry.second.ta.states.begin(),
-                tl_entry.second.ta.states.end(),
-                [source_base_name](const State &s) {
-                  return Filter::getSuffix(s.id, constants::BASE_SEP) ==
-                         source_base_name;
-                });
-            if (source_state != tl_entry.second.ta.states.end()) {
+          if (StateId::of(tr.source_id).plan_action !=
+              StateId::of(tr.dest_id).plan_action) {
+            const Symbol &source_base_name = StateId::of(tr.source_id).base;
+            if (tl_entry.second.containsBase(source_base_name)) {
               tl_entry.second.trans_out.push_back(Transition(
-                  tl_entry.first +
-                      Filter::getSuffix(tr.source_id, constants::BASE_SEP),
-                  tr.dest_id, tr.action,
+                  tl_entry.first + source_base_name, tr.dest_id, tr.action,
                   *addConstraint(*tr.guard.get(), guard).get(), tr.update,
                   tr.sync));
             }
@@ -283,8 +306,8 @@ std::vector<Transition> PlanOrderedTLs::addToPrefixOnTransitions(
     bool on_inner_trans, bool on_outgoing_trans) {
   std::vector<Transition> res;
   for (const auto &tr : trans) {
-    bool is_inner = Filter::getPrefix(tr.source_id, constants::TL_SEP) ==
-                    Filter::getPrefix(tr.dest_id, constants::TL_SEP);
+    bool is_inner = StateId::of(tr.source_id).plan_action ==
+                    StateId::of(tr.dest_id).plan_action;
     if ((is_inner && on_inner_trans) || (!is_inner && on_outgoing_trans)) {
       res.push_back(Transition(encoderutils::addToPrefix(tr.source_id, to_add),
                                encoderutils::addToPrefix(tr.dest_id, to_add),
@@ -295,11 +318,11 @@ std::vector<Transition> PlanOrderedTLs::addToPrefixOnTransitions(
 }
 
 void PlanOrderedTLs::modifyTransitionsToNextTl(
-    std::vector<Transition> &trans, std::string curr_pa,
-    const std::vector<State> &target_states, const ClockConstraint &guard,
+    std::vector<Transition> &trans, const Symbol &curr_pa,
+    const Filter &target_filter, const ClockConstraint &guard,
     const update_t &update, std::string sync, std::string op_name) {
   for (auto &t : trans) {
-    if (Filter::getPrefix(t.dest_id, constants::TL_SEP) != curr_pa) {
+    if (StateId::of(t.dest_id).plan_action != curr_pa) {
       t.guard = addConstraint(*t.guard.get(), guard);
       t.update = addUpdate(t.update, update);
       if (sync != "")
@@ -312,24 +335,18 @@ void PlanOrderedTLs::modifyTransitionsToNextTl(
   trans.erase(
       std::remove_if(
           trans.begin(), trans.end(),
-          [target_states, curr_pa](const Transition &t) {
-            return (Filter::getPrefix(t.dest_id, constants::TL_SEP) !=
-                    curr_pa) &&
-                   (std::find_if(target_states.begin(), target_states.end(),
-                                 [t](const State &s) {
-                                   return Filter::matchesFilter(t.dest_id, "",
-                                                                s.id);
-                                 }) == target_states.end());
+          [&target_filter, &curr_pa](const Transition &t) {
+            return (StateId::of(t.dest_id).plan_action != curr_pa) &&
+                   !target_filter.matchesId(t.dest_id);
           }),
       trans.end());
 }
 
 void PlanOrderedTLs::removeTransitionsToNextTl(std::vector<Transition> &trans,
-                                               std::string curr_pa) {
+                                               const Symbol &curr_pa) {
   trans.erase(std::remove_if(trans.begin(), trans.end(),
-                             [curr_pa](Transition &t) {
-                               return Filter::getPrefix(t.dest_id,
-                                                        constants::TL_SEP) !=
+                             [&curr_pa](Transition &t) {
+                               return StateId::of(t.dest_id).plan_action !=
                                       curr_pa;
                              }),
               trans.end());
@@ -338,23 +355,32 @@ void PlanOrderedTLs::removeTransitionsToNextTl(std::vector<Transition> &trans,
 void PlanOrderedTLs::addStateInvariantToWindow(std::string start_pa,
                                                std::string end_pa,
                                                const ClockConstraint &inv) {
-  auto start_pa_entry =
-      std::find(pa_order.get()->begin(), pa_order.get()->end(), start_pa);
-  if (start_pa_entry == pa_order.get()->end()) {
+  std::size_t start_pa_index = planActionIndex(start_pa);
+  if (start_pa_index == npos) {
     std::cout
         << "PlanOrderedTLs addStateInvariantToWindow: could not find start pa "
         << start_pa << std::endl;
     return;
   }
-  auto end_pa_entry = std::find(start_pa_entry, pa_order.get()->end(), end_pa);
-  if (end_pa_entry == pa_order.get()->end()) {
+  std::size_t end_pa_index = planActionIndex(end_pa);
+  if (end_pa_index == npos || end_pa_index < start_pa_index) {
     std::cout
         << "PlanOrderedTLs addStateInvariantToWindow: could not find end pa "
         << end_pa << std::endl;
     return;
   }
-  size_t curr_pa_index = start_pa_entry - pa_order.get()->begin();
-  size_t end_pa_index = end_pa_entry - pa_order.get()->begin();
+  addStateInvariantToWindow(start_pa_index, end_pa_index, inv);
+}
+
+void PlanOrderedTLs::addStateInvariantToWindow(std::size_t start_pa_index,
+                                               std::size_t end_pa_index,
+                                               const ClockConstraint &inv) {
+  if (end_pa_index >= pa_order.get()->size()) {
+    std::cout << "PlanOrderedTLs addStateInvariantToWindow: invalid window "
+              << start_pa_index << "," << end_pa_index << std::endl;
+    return;
+  }
+  size_t curr_pa_index = start_pa_index;
   while (curr_pa_index <= end_pa_index) {
     auto curr_tl = tls.get()->find(*(pa_order.get()->begin() + curr_pa_index));
     if (curr_tl == tls.get()->end()) {
@@ -364,8 +390,7 @@ void PlanOrderedTLs::addStateInvariantToWindow(std::string start_pa,
       break;
     }
     for (auto &tl_entry : curr_tl->second) {
-      encoderutils::addInvariants(tl_entry.second.ta, tl_entry.second.ta.states,
-                                  inv);
+      tl_entry.second.addInvariant(inv);
     }
     curr_pa_index++;
   }
@@ -373,10 +398,10 @@ void PlanOrderedTLs::addStateInvariantToWindow(std::string start_pa,
 
 Automaton PlanOrderedTLs::collapseTL(const TimeLine &tl, std::string tl_name,
                                      std::vector<Transition> &outgoing) {
-  std::vector<Automaton> automata;
+  std::vector<const TlEntry *> copies;
   std::vector<Transition> interconnections;
   for (const auto &curr_copy : tl) {
-    automata.push_back(curr_copy.second.ta);
+    copies.push_back(&curr_copy.second);
     interconnections.insert(interconnections.end(),
                             curr_copy.second.trans_out.begin(),
                             curr_copy.second.trans_out.end());
@@ -386,7 +411,7 @@ Automaton PlanOrderedTLs::collapseTL(const TimeLine &tl, std::string tl_name,
                  return (not Filter::matchesFilter(tr.dest_id, tl_name, ""));
                });
   PlanOrderedTLs::removeTransitionsToNextTl(interconnections, tl_name);
-  return encoderutils::mergeAutomata(automata, interconnections, tl_name);
+  return encoderutils::mergeAutomata(copies, interconnections, tl_name);
 }
 
 TimeLine PlanOrderedTLs::replaceStatesByTA(const Automaton &source_ta,
@@ -404,10 +429,7 @@ TimeLine PlanOrderedTLs::replaceStatesByTA(const Automaton &source_ta,
       curr_trans.dest_id =
           encoderutils::mergeIds(ta_state.id, curr_trans.dest_id);
       std::string dummy_action = "";
-      for (long int i = 0;
-           i < std::count(ta_state.id.begin(), ta_state.id.end(),
-                          constants::COMPONENT_SEP);
-           i++) {
+      for (size_t i = 1; i < StateId::of(ta_state.id).num_components; i++) {
         dummy_action += constants::ACTION_SEP;
       }
       curr_trans.action =
@@ -425,11 +447,9 @@ TimeLine PlanOrderedTLs::replaceStatesByTA(const Automaton &source_ta,
     }
     // automata generation complete
     auto emp = product_tas.emplace(
-        make_pair(ta_state.id, TlEntry(state_ta, std::vector<Transition>())));
+        std::make_pair(ta_state.id, TlEntry(state_ta, std::vector<Transition>())));
     if (emp.second == true) {
-      encoderutils::addInvariants(emp.first->second.ta,
-                                  emp.first->second.ta.states,
-                                  *ta_state.inv.get());
+      emp.first->second.addInvariant(*ta_state.inv.get());
     } else {
       std::cout << "PlanOrderedTLs replaceStatesByTA: error while creating TA "
                    "copy. Another copy with this name already exists: "
@@ -446,9 +466,7 @@ TimeLine PlanOrderedTLs::replaceStatesByTA(const Automaton &source_ta,
         copy_trans.source_id = encoderutils::mergeIds(ta_trans.source_id, s.id);
         copy_trans.dest_id = encoderutils::mergeIds(ta_trans.dest_id, s.id);
         std::string dummy_action = "";
-        for (long int i = 0;
-             i < std::count(s.id.begin(), s.id.end(), constants::COMPONENT_SEP);
-             i++) {
+        for (size_t i = 1; i < StateId::of(s.id).num_components; i++) {
           dummy_action += constants::ACTION_SEP;
         }
         copy_trans.action =
@@ -484,7 +502,7 @@ PlanOrderedTLs
 PlanOrderedTLs::mergePlanOrderedTLs(const PlanOrderedTLs &other) const {
   PlanOrderedTLs res;
   for (const auto &pa : *(pa_order.get())) {
-    res.pa_order.get()->push_back(pa);
+    res.addPlanAction(pa);
   }
   for (const auto &curr_tl : *(tls.get())) {
     auto other_tl = other.tls.get()->find(curr_tl.first);
@@ -498,14 +516,16 @@ PlanOrderedTLs::mergePlanOrderedTLs(const PlanOrderedTLs &other) const {
       Automaton merged_other_ta = PlanOrderedTLs::collapseTL(
           other_tl->second, other_tl->first, outgoing);
       for (const auto &entry : curr_tl.second) {
+        std::optional<Automaton> entry_buffer;
         Automaton merged_res_ta = PlanOrderedTLs::productTA(
-            entry.second.ta, merged_other_ta, entry.first, false);
+            entry.second.view(entry_buffer), merged_other_ta, entry.first,
+            false);
         // what about outgoing trans?!!?!?!?!?!?
         std::vector<Transition> product_trans_out;
         for (const auto &this_ic_trans : entry.second.trans_out) {
           if (this_ic_trans.dest_id != constants::QUERY &&
-              Filter::getPrefix(this_ic_trans.source_id, constants::TL_SEP) ==
-                  Filter::getPrefix(this_ic_trans.dest_id, constants::TL_SEP)) {
+              StateId::of(this_ic_trans.source_id).plan_action ==
+                  StateId::of(this_ic_trans.dest_id).plan_action) {
             // transitions within timelines
             for (const auto &s : merged_other_ta.states) {
               Transition copy_trans = this_ic_trans;
@@ -514,9 +534,7 @@ PlanOrderedTLs::mergePlanOrderedTLs(const PlanOrderedTLs &other) const {
               copy_trans.dest_id =
                   encoderutils::mergeIds(this_ic_trans.dest_id, s.id);
               std::string dummy_action = "";
-              for (long int i = 0; i < std::count(s.id.begin(), s.id.end(),
-                                                  constants::COMPONENT_SEP);
-                   i++) {
+              for (size_t i = 1; i < StateId::of(s.id).num_components; i++) {
                 dummy_action += constants::ACTION_SEP;
               }
               copy_trans.action =
@@ -544,10 +562,8 @@ PlanOrderedTLs::mergePlanOrderedTLs(const PlanOrderedTLs &other) const {
             }
           }
         }
-        merged_res_ta.clocks.insert(entry.second.ta.clocks.begin(),
-                                    entry.second.ta.clocks.end());
-        merged_res_ta.clocks.insert(merged_other_ta.clocks.begin(),
-                                    merged_other_ta.clocks.end());
+        merged_res_ta.clocks |= entry.second.clocks;
+        merged_res_ta.clocks |= merged_other_ta.clocks;
         (*res.tls.get())[curr_tl.first].emplace(std::make_pair(
             entry.first, TlEntry(merged_res_ta, product_trans_out)));
       }
@@ -560,13 +576,109 @@ Automaton PlanOrderedTLs::productTA(const Automaton &ta1, const Automaton &ta2,
                                     std::string name, bool add_succ_trans) {
 
   TimeLine product_tas = replaceStatesByTA(ta1, ta2, add_succ_trans);
-  std::vector<Automaton> res_tas;
+  std::vector<const TlEntry *> res_copies;
   std::vector<Transition> res_inner_trans;
-  for (const auto merged_entry : product_tas) {
-    res_tas.push_back(merged_entry.second.ta);
+  for (const auto &merged_entry : product_tas) {
+    res_copies.push_back(&merged_entry.second);
     res_inner_trans.insert(res_inner_trans.end(),
                            merged_entry.second.trans_out.begin(),
                            merged_entry.second.trans_out.end());
   }
-  return encoderutils::mergeAutomata(res_tas, res_inner_trans, name);
+  return encoderutils::mergeAutomata(res_copies, res_inner_trans, name);
+}
+
+/**
+ * \internal
+ * Product states are numbered by the positions of their components, so a
+ * visited flag per pair suffices to explore them with a worklist.
+ * \endinternal
+ */
+Automaton PlanOrderedTLs::reachableProductTA(const Automaton &ta1,
+                                             const Automaton &ta2,
+                                             std::string name,
+                                             bool add_succ_trans) {
+  AutomatonIndex index1(ta1);
+  AutomatonIndex index2(ta2);
+  size_t num_states2 = ta2.states.size();
+  std::vector<bool> visited(ta1.states.size() * num_states2, false);
+  std::vector<std::pair<size_t, size_t>> worklist;
+  auto visit = [&](size_t pos1, size_t pos2) {
+    if (pos1 == AutomatonIndex::npos || pos2 == AutomatonIndex::npos) {
+      return;
+    }
+    if (!visited[pos1 * num_states2 + pos2]) {
+      visited[pos1 * num_states2 + pos2] = true;
+      worklist.push_back(std::make_pair(pos1, pos2));
+    }
+  };
+  for (size_t i = 0; i < ta1.states.size(); i++) {
+    if (!ta1.states[i].initial) {
+      continue;
+    }
+    for (size_t j = 0; j < num_states2; j++) {
+      if (ta2.states[j].initial) {
+        visit(i, j);
+      }
+    }
+  }
+  std::vector<State> res_states;
+  std::vector<Transition> res_trans;
+  while (!worklist.empty()) {
+    auto [pos1, pos2] = worklist.back();
+    worklist.pop_back();
+    const State &s1 = ta1.states[pos1];
+    const State &s2 = ta2.states[pos2];
+    State curr_state = s2;
+    curr_state.id = encoderutils::mergeIds(s1.id, s2.id);
+    curr_state.inv = FlatCC::conjunction(*s2.inv.get(), *s1.inv.get());
+    curr_state.initial = s1.initial && s2.initial;
+    res_states.push_back(curr_state);
+    // transitions of ta2 while staying in s1
+    std::string dummy_action = "";
+    for (size_t i = 1; i < StateId::of(s1.id).num_components; i++) {
+      dummy_action += constants::ACTION_SEP;
+    }
+    for (size_t trans_pos2 : index2.outgoing(pos2)) {
+      const Transition &tr2 = ta2.transitions[trans_pos2];
+      Transition curr_trans = tr2;
+      curr_trans.source_id = encoderutils::mergeIds(s1.id, tr2.source_id);
+      curr_trans.dest_id = encoderutils::mergeIds(s1.id, tr2.dest_id);
+      curr_trans.action = encoderutils::mergeActions(tr2.action, dummy_action);
+      res_trans.push_back(curr_trans);
+      visit(pos1, index2.stateIndex(tr2.dest_id));
+    }
+    // transitions of ta1 while staying in s2
+    dummy_action = "";
+    for (size_t i = 1; i < StateId::of(s2.id).num_components; i++) {
+      dummy_action += constants::ACTION_SEP;
+    }
+    for (size_t trans_pos1 : index1.outgoing(pos1)) {
+      const Transition &tr1 = ta1.transitions[trans_pos1];
+      Transition copy_trans = tr1;
+      copy_trans.source_id = encoderutils::mergeIds(tr1.source_id, s2.id);
+      copy_trans.dest_id = encoderutils::mergeIds(tr1.dest_id, s2.id);
+      copy_trans.action = encoderutils::mergeActions(dummy_action, tr1.action);
+      res_trans.push_back(copy_trans);
+      visit(index1.stateIndex(tr1.dest_id), pos2);
+      if (!add_succ_trans) {
+        continue;
+      }
+      for (size_t trans_pos2 : index2.outgoing(pos2)) {
+        const Transition &tr2 = ta2.transitions[trans_pos2];
+        Transition succ_trans = tr1;
+        succ_trans.source_id =
+            encoderutils::mergeIds(tr1.source_id, tr2.source_id);
+        succ_trans.dest_id = encoderutils::mergeIds(tr1.dest_id, tr2.dest_id);
+        succ_trans.guard = addConstraint(*tr1.guard.get(), *tr2.guard.get());
+        succ_trans.update = addUpdate(tr1.update, tr2.update);
+        succ_trans.action = encoderutils::mergeActions(tr1.action, tr2.action);
+        res_trans.push_back(succ_trans);
+        visit(index1.stateIndex(tr1.dest_id), index2.stateIndex(tr2.dest_id));
+      }
+    }
+  }
+  std::vector<Transition> no_interconnections;
+  return encoderutils::mergeAutomata(
+      {Automaton(res_states, res_trans, name, false)}, no_interconnections,
+      name);
 }
@@ -6,13 +6,17 @@
 #pragma once
 #include "filter.h"
 #include "timed_automata.h"
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace taptenc {
-typedef ::std::unordered_map<::std::string, ::std::string> OrigMap;
+typedef ::std::unordered_map<Symbol, Symbol, ::std::hash<Symbol>,
+                             ::std::equal_to<Symbol>,
+                             ArenaAllocator<::std::pair<const Symbol, Symbol>>>
+    OrigMap;
 /**
  * Bundles functionalities to manipulate TimeLines.
  *
@@ -44,15 +48,34 @@ private:
                                     const Automaton &ta_to_insert,
                                     bool add_succ_trans);
 
+  /** Position of each plan action within \a pa_order. */
+  ::std::unordered_map<Symbol, ::std::size_t> pa_pos;
+
 public:
+  /** Position returned by planActionIndex() for unknown plan actions. */
+  static constexpr ::std::size_t npos = static_cast<::std::size_t>(-1);
   /** Unique access to a TimeLines instance. */
   ::std::unique_ptr<TimeLines> tls = ::std::make_unique<TimeLines>();
   /**
    * Unique access to a vector representing a sequential plan ordering.
    * The entries of \a pa_order are keys of \a tls.
+   * Use addPlanAction() to extend it, so positions can be looked up.
    * */
-  ::std::unique_ptr<::std::vector<::std::string>> pa_order =
-      ::std::make_unique<::std::vector<::std::string>>();
+  ::std::unique_ptr<::std::vector<Symbol>> pa_order =
+      ::std::make_unique<::std::vector<Symbol>>();
+
+  /**
+   * Appends a plan action to the plan ordering.
+   * @param pa plan action name
+   */
+  void addPlanAction(const Symbol &pa);
+  /**
+   * Looks up the position of a plan action in the plan ordering.
+   * @param pa plan action name
+   * @return position of \a pa within \a pa_order or npos if it is not
+   *         contained
+   */
+  ::std::size_t planActionIndex(const Symbol &pa) const;
 
   /**
    * Adds an invariant to all states within a window in the timelines.
@@ -62,6 +85,15 @@ public:
    */
   void addStateInvariantToWindow(::std::string start_pa, ::std::string end_pa,
                                  const ClockConstraint &inv);
+  /**
+   * Adds an invariant to all states within a window in the timelines.
+   * @param start_pa_index position of the start of the window in \a pa_order
+   * @param end_pa_index position of the end of the window in \a pa_order
+   * @param inv invariant to add
+   */
+  void addStateInvariantToWindow(::std::size_t start_pa_index,
+                                 ::std::size_t end_pa_index,
+                                 const ClockConstraint &inv);
   /**
    * Adds outgoing transitions of the original timeline to a copied timeline.
    * ~~~
@@ -105,7 +137,7 @@ public:
    * @param trans transitions to modify
    * @param curr_pa current plan action (to determine outgoing transitions)
    *        TODO can be refactored away
-   * @param target_states specify states of a target window, useful if the
+   * @param target_filter specify states of a target window, useful if the
    *        destination prefix is modified and the new target automaton does
    *        not have the target state of a transition. Then the transition
    *        becomes obsolete and has to be deleted
@@ -115,8 +147,8 @@ public:
    * @param op_name add an operator to the prefix of the dest states
    */
   static void modifyTransitionsToNextTl(
-      ::std::vector<Transition> &trans, ::std::string curr_pa,
-      const ::std::vector<State> &target_states, const ClockConstraint &guard,
+      ::std::vector<Transition> &trans, const Symbol &curr_pa,
+      const Filter &target_filter, const ClockConstraint &guard,
       const update_t &update, ::std::string sync, ::std::string op_name = "");
 
   /**
@@ -130,7 +162,7 @@ public:
    *        TODO refactor this away
    */
   static void removeTransitionsToNextTl(::std::vector<Transition> &trans,
-                                        ::std::string curr_pa);
+                                        const Symbol &curr_pa);
   /**
    * Creates a map from each automata name (added by a prefix) in tls to the
    * same name
@@ -152,6 +184,19 @@ public:
   PlanOrderedTLs createWindow(::std::string start_pa, ::std::string end_pa,
                               const Filter &target_filter,
                               ::std::string prefix_add) const;
+  /**
+   * Creates copies of the timelines in tls within an interval specified
+   * by positions in the plan ordering.
+   * @param context_start position in \a pa_order that starts the window
+   * @param context_end position in \a pa_order that ends the window
+   * @param target_filter state filter to apply on all copied automata
+   * @param prefix_add prefix to be added to the original TA names
+   * @return tls between both positions with added prefix and filtered states
+   */
+  PlanOrderedTLs createWindow(::std::size_t context_start,
+                              ::std::size_t context_end,
+                              const Filter &target_filter,
+                              ::std::string prefix_add) const;
   /**
    * Creates successor and copy transitions to other timelines.
    * @param base_ta the full automaton where all automata copies originated from
@@ -168,10 +213,31 @@ public:
    */
   void createTransitionsToWindow(
       const Automaton &base_ta, TimeLines &dest_tls,
-      const ::std::unordered_map<std::string, ::std::string> &map_to_orig,
+      const OrigMap &map_to_orig,
       ::std::string start_pa, ::std::string end_pa, const Filter &target_filter,
       const ClockConstraint &guard, const update_t &update,
       bool add_succ_trans);
+  /**
+   * Creates successor and copy transitions to other timelines.
+   * Same as above, but the window is given by positions in \a pa_order.
+   * @param base_ta the full automaton where all automata copies originated from
+   * @param dest_tls target timelines
+   * @param map_to_orig Mapping to match copies of target timelines to timeline
+   *        entries of tls
+   * @param context_start position in \a pa_order that starts the window
+   * @param context_end position in \a pa_order that ends the window
+   * @param target_filter filter describing the target states within dest_tls
+   *        that should be reached
+   * @param guard guard to add on the created transitions
+   * @param update update to add on the created transitions
+   * @param add_succ_trans if true, also adds successor transitions
+   */
+  void createTransitionsToWindow(
+      const Automaton &base_ta, TimeLines &dest_tls,
+      const OrigMap &map_to_orig, ::std::size_t context_start,
+      ::std::size_t context_end, const Filter &target_filter,
+      const ClockConstraint &guard, const update_t &update,
+      bool add_succ_trans);
 
   /**
    * Merges a timeline window into tls.
@@ -211,5 +277,24 @@ public:
    */
   static Automaton productTA(const Automaton &ta1, const Automaton &ta2,
                              ::std::string name, bool add_succ_trans);
+
+  /**
+   * Constructs the part of the product TA between two TAs that is reachable
+   * from its initial states.
+   *
+   * States and transitions are the same as the ones of productTA, but only
+   * product states that can be reached from a pair of initial states via
+   * product transitions (ignoring guards and invariants) are generated.
+   *
+   * @param ta1 first ta of the product
+   * @param ta2 second ta of the product
+   * @param name name of the product ta
+   * @param add_succ_trans if true, adds transitions that simultaniously
+   *                       change states in ta1 and ta2
+   * @return reachable part of the product ta of ta1 and ta2
+   */
+  static Automaton reachableProductTA(const Automaton &ta1,
+                                      const Automaton &ta2, ::std::string name,
+                                      bool add_succ_trans);
 };
 } // end namespace taptenc
@@ -0,0 +1,252 @@
+/** \file
+ * Persistent cache of plan transformation results.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "encoding_cache.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+using namespace taptenc;
+
+namespace {
+/** First line of each cache entry, bump the version on format changes. */
+constexpr char ENTRY_HEADER[]{"taptenc-trace 2"};
+
+/**
+ * 64-bit FNV-1a hash.
+ *
+ * @param data bytes to hash
+ * @return hash of \a data
+ */
+uint64_t fnv1a(const std::string &data) {
+  uint64_t res = 14695981039346656037ull;
+  for (unsigned char c : data) {
+    res ^= c;
+    res *= 1099511628211ull;
+  }
+  return res;
+}
+
+void describeBounds(std::ostream &os, const Bounds &b) {
+  os << computils::toString(b.l_op) << b.lower_bound << ","
+     << computils::toString(b.r_op) << b.upper_bound << ";";
+}
+
+void describeStates(std::ostream &os, const std::vector<State> &states) {
+  os << states.size() << "{";
+  for (const auto &s : states) {
+    os << s.id << "|" << s.inv->toString() << "|" << s.urgent << s.initial
+       << ";";
+  }
+  os << "}";
+}
+
+void describeAutomaton(std::ostream &os, const Automaton &ta) {
+  os << "ta " << ta.prefix << "\n";
+  describeStates(os, ta.states);
+  os << "\n" << ta.transitions.size() << "{";
+  for (const auto &t : ta.transitions) {
+    os << t.source_id << "|" << t.dest_id << "|" << t.action << "|"
+       << t.guard->toString() << "|" << t.updateToString() << "|" << t.sync
+       << "|" << t.passive << ";";
+  }
+  os << "}\n";
+  for (const auto &var : ta.bool_vars) {
+    os << var << ";";
+  }
+  os << "\n";
+}
+
+void describeActions(std::ostream &os, const std::vector<ActionName> &acts) {
+  os << acts.size() << "{";
+  for (const auto &act : acts) {
+    os << act.toString() << ";";
+  }
+  os << "}";
+}
+
+void describeSpecs(std::ostream &os, const TargetSpecs &specs) {
+  describeBounds(os, specs.bounds);
+  describeStates(os, specs.targets);
+}
+
+void describeConstraint(std::ostream &os, const EncICInfo &info) {
+  os << "ic " << info.name << " " << info.type << " ";
+  describeActions(os, info.activations);
+  if (const UnaryInfo *unary = dynamic_cast<const UnaryInfo *>(&info)) {
+    describeSpecs(os, unary->specs);
+  } else if (const BinaryInfo *binary =
+                 dynamic_cast<const BinaryInfo *>(&info)) {
+    describeSpecs(os, binary->specs);
+    describeStates(os, binary->pre_targets);
+  } else if (const ChainInfo *chain = dynamic_cast<const ChainInfo *>(&info)) {
+    os << chain->specs_list.size() << "{";
+    for (const auto &specs : chain->specs_list) {
+      describeSpecs(os, specs);
+    }
+    os << "}";
+    describeActions(os, chain->activations_end);
+  }
+  os << "\n";
+}
+} // end anonymous namespace
+
+EncodingCache::EncodingCache(std::string dir) : dir(dir) {
+  if (this->dir.empty()) {
+    const char *env_dir = std::getenv("TAPTENC_CACHE_DIR");
+    this->dir = (env_dir == nullptr) ? "" : env_dir;
+  }
+}
+
+std::string EncodingCache::key(
+    const std::vector<PlanAction> &plan,
+    const std::vector<Automaton> &platform_models,
+    const std::vector<std::vector<std::unique_ptr<EncICInfo>>>
+        &platform_constraints,
+    const std::string &config) {
+  std::ostringstream desc;
+  desc << "config " << config << "\n";
+  desc << "plan " << plan.size() << "\n";
+  for (const auto &pa : plan) {
+    desc << pa.name.toString() << " ";
+    describeBounds(desc, pa.absolute_time);
+    describeBounds(desc, pa.duration);
+    desc << "\n";
+  }
+  for (const auto &ta : platform_models) {
+    describeAutomaton(desc, ta);
+  }
+  for (const auto &constraints : platform_constraints) {
+    desc << "constraints " << constraints.size() << "\n";
+    for (const auto &info : constraints) {
+      describeConstraint(desc, *info);
+    }
+  }
+  return desc.str();
+}
+
+/**
+ * \internal
+ * Different keys may share an entry file, the key stored in the entry tells
+ * them apart.
+ * \endinternal
+ */
+std::string EncodingCache::entryPath(const std::string &key) const {
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(key)
+       << ".trace";
+  return (std::filesystem::path(dir) / name.str()).string();
+}
+
+bool EncodingCache::lookup(const std::string &key,
+                           timed_trace_t &trace) const {
+  if (!enabled()) {
+    return false;
+  }
+  std::ifstream entry(entryPath(key));
+  if (!entry) {
+    return false;
+  }
+  std::string header;
+  std::getline(entry, header);
+  size_t key_size = 0;
+  if (header != ENTRY_HEADER || !(entry >> key_size) || entry.get() != '\n') {
+    std::cout << "EncodingCache lookup: ignore malformed entry "
+              << entryPath(key) << std::endl;
+    return false;
+  }
+  std::string entry_key(key_size, '\0');
+  if (!entry.read(&entry_key[0], key_size) || entry_key != key) {
+    // hash collision or truncated entry
+    return false;
+  }
+  size_t num_steps = 0;
+  if (!(entry >> num_steps)) {
+    std::cout << "EncodingCache lookup: ignore malformed entry "
+              << entryPath(key) << std::endl;
+    return false;
+  }
+  timed_trace_t res;
+  for (size_t i = 0; i < num_steps; i++) {
+    GroundedActionTime time;
+    size_t num_actions = 0;
+    if (!(entry >> time.earliest_start >> time.max_delay >> num_actions)) {
+      std::cout << "EncodingCache lookup: ignore truncated entry "
+                << entryPath(key) << std::endl;
+      return false;
+    }
+    entry >> std::ws;
+    std::vector<std::string> actions(num_actions);
+    for (auto &act : actions) {
+      std::getline(entry, act);
+    }
+    res.push_back(std::make_pair(time, actions));
+  }
+  if (!entry) {
+    std::cout << "EncodingCache lookup: ignore truncated entry "
+              << entryPath(key) << std::endl;
+    return false;
+  }
+  trace = std::move(res);
+  return true;
+}
+
+/**
+ * \internal
+ * The entry is written to a temporary file first and then renamed, so
+ * concurrent processes never read partially written entries.
+ * \endinternal
+ */
+void EncodingCache::store(const std::string &key,
+                          const timed_trace_t &trace) const {
+  if (!enabled()) {
+    return;
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    std::cout << "EncodingCache store: cannot create directory " << dir << ": "
+              << ec.message() << std::endl;
+    return;
+  }
+  std::string path = entryPath(key);
+  // unique per process and thread, as jobs of a solver pool store entries
+  // concurrently
+  std::string tmp_path =
+      path + ".tmp" + std::to_string(getpid()) + "-" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream entry(tmp_path, std::ios_base::trunc);
+    entry << ENTRY_HEADER << "\n" << key.size() << "\n" << key << "\n"
+          << trace.size() << "\n";
+    for (const auto &step : trace) {
+      entry << step.first.earliest_start << " " << step.first.max_delay << " "
+            << step.second.size() << "\n";
+      for (const auto &act : step.second) {
+        entry << act << "\n";
+      }
+    }
+    if (!entry) {
+      std::cout << "EncodingCache store: cannot write " << tmp_path
+                << std::endl;
+      std::filesystem::remove(tmp_path, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::cout << "EncodingCache store: cannot write " << path << ": "
+              << ec.message() << std::endl;
+    std::filesystem::remove(tmp_path, ec);
+  }
+}
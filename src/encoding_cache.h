@@ -0,0 +1,82 @@
+/** \file
+ * Persistent cache of plan transformation results.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include "enc_interconnection_info.h"
+#include "timed_automata.h"
+#include "utap_trace_parser.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace taptenc {
+/**
+ * Stores solved plan transformations on disk, so repeated requests for the
+ * same plan, platform models and constraints skip encoding and solving.
+ *
+ * Each entry is a file inside the cache directory named by a hash of the key
+ * of the request (see key()). The content is the key followed by the
+ * resulting timed trace, entries with a different key are ignored.
+ */
+class EncodingCache {
+public:
+  /**
+   * Creates a cache.
+   *
+   * @param dir cache directory, if empty the directory is taken from the
+   *            environment variable TAPTENC_CACHE_DIR. The cache is disabled
+   *            if neither is set.
+   */
+  explicit EncodingCache(::std::string dir = "");
+
+  /**
+   * Computes the key of a transformation request.
+   *
+   * The key is a textual description of all arguments, hence it changes
+   * whenever the encoding would change.
+   *
+   * @param plan plan to transform
+   * @param platform_models platform models realizing platform behavior
+   * @param platform_constraints constraints of each platform model
+   * @param config description of the encoder and solver configuration that
+   *               produces the result
+   * @return key of the request
+   */
+  static ::std::string
+  key(const ::std::vector<PlanAction> &plan,
+      const ::std::vector<Automaton> &platform_models,
+      const ::std::vector<::std::vector<::std::unique_ptr<EncICInfo>>>
+          &platform_constraints,
+      const ::std::string &config);
+
+  /**
+   * Looks up a cached trace.
+   *
+   * @param key key of the request
+   * @param trace receives the cached trace
+   * @return true iff a trace is cached for \a key
+   */
+  bool lookup(const ::std::string &key, timed_trace_t &trace) const;
+
+  /**
+   * Stores a trace, existing entries are replaced.
+   *
+   * @param key key of the request
+   * @param trace trace to store
+   */
+  void store(const ::std::string &key, const timed_trace_t &trace) const;
+
+  /** @return true iff a cache directory is set */
+  bool enabled() const { return !dir.empty(); }
+
+private:
+  ::std::string dir;
+
+  ::std::string entryPath(const ::std::string &key) const;
+};
+} // end namespace taptenc
@@ -0,0 +1,28 @@
+/** \file
+ * Memory arenas that bundle the allocations of one encoder build.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "memory_arena.h"
+
+using namespace taptenc;
+
+namespace {
+thread_local std::pmr::memory_resource *current_arena = nullptr;
+} // end anonymous namespace
+
+MemoryArena::MemoryArena() : pool(std::pmr::new_delete_resource()) {}
+
+std::pmr::memory_resource *MemoryArena::current() {
+  if (current_arena == nullptr) {
+    return std::pmr::new_delete_resource();
+  }
+  return current_arena;
+}
+
+MemoryArena::Scope::Scope(MemoryArena &arena) : prev(current_arena) {
+  current_arena = arena.resource();
+}
+
+MemoryArena::Scope::~Scope() { current_arena = prev; }
@@ -0,0 +1,137 @@
+/** \file
+ * Memory arenas that bundle the allocations of one encoder build.
+ *
+ * Building an encoding creates and destroys a lot of small hash map nodes
+ * (the entries of TimeLine and TimeLines as well as OrigMap). Containers
+ * using an ArenaAllocator obtain their memory from the arena that is
+ * installed on the current thread, which pools the nodes and returns all of
+ * them to the system at once when the arena is destroyed.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+namespace taptenc {
+/**
+ * Pooled memory resource that releases all its memory at destruction.
+ *
+ * An arena does nothing on its own, it has to be installed on a thread by a
+ * Scope to be used by ArenaAllocators. Containers allocated from an arena
+ * must not outlive it, hence each encoder should be built in an arena that
+ * is owned together with the encoder (see ArenaOwned).
+ *
+ * The arena is not thread safe, each thread should use its own arena. Memory
+ * of an arena may be used by other threads once the allocating thread is
+ * done with it.
+ */
+class MemoryArena {
+public:
+  /** Installs an arena on the current thread for the lifetime of a scope. */
+  class Scope {
+  public:
+    /**
+     * Installs an arena on the current thread.
+     *
+     * @param arena arena that serves all ArenaAllocators constructed on this
+     *              thread until the scope ends
+     */
+    Scope(MemoryArena &arena);
+    /** Restores the arena that was installed before. */
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    ::std::pmr::memory_resource *prev;
+  };
+
+  MemoryArena();
+  MemoryArena(const MemoryArena &) = delete;
+  MemoryArena &operator=(const MemoryArena &) = delete;
+
+  ::std::pmr::memory_resource *resource() { return &pool; }
+
+  /**
+   * Obtains the memory resource that is installed on the current thread.
+   *
+   * @return resource of the innermost arena scope or the new/delete resource
+   *         if no scope is active
+   */
+  static ::std::pmr::memory_resource *current();
+
+private:
+  ::std::pmr::unsynchronized_pool_resource pool;
+};
+
+/**
+ * Allocator drawing from the arena of the current thread.
+ *
+ * The arena is fixed when the allocator is constructed. Copies of containers
+ * are allocated from the arena that is current at the time of copying, so
+ * copying a container out of an arena scope is safe, moving it is not.
+ */
+template <class T>
+class ArenaAllocator : public ::std::pmr::polymorphic_allocator<T> {
+public:
+  ArenaAllocator() noexcept
+      : ::std::pmr::polymorphic_allocator<T>(MemoryArena::current()) {}
+  ArenaAllocator(const ArenaAllocator &other) noexcept = default;
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U> &other) noexcept
+      : ::std::pmr::polymorphic_allocator<T>(other.resource()) {}
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+};
+
+/**
+ * Object built within an arena of its own.
+ *
+ * The arena is owned together with the object and released right after the
+ * object is destroyed, so the memory of intermediate results (such as
+ * encodings that are merged already) is returned as soon as they are
+ * consumed. Moving transfers the arena together with the object.
+ */
+template <class T> class ArenaOwned {
+public:
+  /**
+   * Builds an object while a new arena is installed on the current thread.
+   *
+   * @param build callable without arguments returning the object
+   * @return object owning the arena it was built in
+   */
+  template <class F> static ArenaOwned build(F &&build) {
+    ArenaOwned res;
+    res.arena = ::std::make_unique<MemoryArena>();
+    MemoryArena::Scope scope(*res.arena);
+    res.value = ::std::make_unique<T>(::std::forward<F>(build)());
+    return res;
+  }
+
+  ArenaOwned(ArenaOwned &&other) noexcept = default;
+  /** Destroys the current object before its arena. */
+  ArenaOwned &operator=(ArenaOwned &&other) noexcept {
+    value = ::std::move(other.value);
+    arena = ::std::move(other.arena);
+    return *this;
+  }
+
+  T &operator*() { return *value; }
+  const T &operator*() const { return *value; }
+  T *operator->() { return value.get(); }
+  const T *operator->() const { return value.get(); }
+
+private:
+  ArenaOwned() = default;
+  /** Declared before \a value, so it is destroyed after it. */
+  ::std::unique_ptr<MemoryArena> arena;
+  ::std::unique_ptr<T> value;
+};
+} // end namespace taptenc
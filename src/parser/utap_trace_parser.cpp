@@ -8,6 +8,8 @@
 #include "../constraints/constraints.h"
 #include "../encoder/filter.h"
 #include "../printer/printer.h"
+#include "../solver/zone_solver.h"
+#include "../timed-automata/state_id.h"
 #include "../timed-automata/timed_automata.h"
 #include "../uppaal_calls.h"
 #include "../utils.h"
@@ -203,17 +205,22 @@ void UTAPTraceParser::parseState(std::string &currentReadLine) {
       cout << "UTAPTraceParser parseState: ERROR duplicate dbm entry" << endl;
     }
   }
+  ingestState(parsed_state_name, closed_dbm);
+}
+
+void UTAPTraceParser::ingestState(const std::string &state_id,
+                                  const dbm_t &zone) {
   if (parsed) {
     // we currently parse a trace from the trace TA, therefore the name is
     // already correct.
-    ta_to_symbolic_state.insert(std::make_pair(parsed_state_name, closed_dbm));
+    ta_to_symbolic_state.insert(std::make_pair(state_id, zone));
   } else {
     size_t state_suffix = trace_ta.states.size();
     if (trace_ta.states.size() != 0) {
       state_suffix -= 1;
     }
     ta_to_symbolic_state.insert(
-        std::make_pair("trace" + std::to_string(state_suffix), closed_dbm));
+        std::make_pair("trace" + std::to_string(state_suffix), zone));
   }
 }
 
@@ -250,6 +257,16 @@ void UTAPTraceParser::parseTransition(std::string &currentReadLine) {
   guard_str = (guard_str == "1") ? "" : convertCharsToHTML(guard_str);
   sync_str = (sync_str == "0") ? "" : convertCharsToHTML(sync_str);
   update_str = (update_str == "1") ? "" : convertCharsToHTML(update_str);
+  ingestTransition(source_id, dest_id, FlatCC::of(UnparsedCC(guard_str)),
+                   Transition::updateFromString(update_str, trace_ta.clocks),
+                   sync_str);
+}
+
+void UTAPTraceParser::ingestTransition(const std::string &source_id,
+                                       const std::string &dest_id,
+                                       const FlatCCPtr &guard,
+                                       const update_t &update,
+                                       const std::string &sync) {
   // add parsed transition to trace ta
   std::string trace_ta_source_id = source_id;
   std::string trace_ta_dest_id = dest_id;
@@ -264,7 +281,7 @@ void UTAPTraceParser::parseTransition(std::string &currentReadLine) {
                  t.dest_id == trace_ta_dest_id;
         });
     if (trans_entry != trace_ta.transitions.end()) {
-      trans_entry->guard = std::make_unique<UnparsedCC>(UnparsedCC(guard_str));
+      trans_entry->guard = guard;
     } else {
       std::cout << "UTAPTraceParser parseTransition: cannot find original "
                    "transition while parsing trace from trace TA: "
@@ -281,70 +298,79 @@ void UTAPTraceParser::parseTransition(std::string &currentReadLine) {
           "trace" + std::to_string((trace_to_ta_ids.size() - 1));
     }
     trace_ta_dest_id = addStateToTraceTA(dest_id);
-    trace_ta.transitions.push_back(Transition(
-        trace_ta_source_id, trace_ta_dest_id, "", UnparsedCC(guard_str),
-        Transition::updateFromString(update_str, trace_ta.clocks), sync_str));
+    trace_ta.transitions.push_back(Transition(trace_ta_source_id,
+                                              trace_ta_dest_id, "", *guard,
+                                              update, sync));
   }
 }
 
 ::std::vector<::std::string>
 UTAPTraceParser::getActionsFromTraceTrans(const Transition &trans,
                                           const Automaton &base_ta,
-                                          const Automaton &plan_ta) {
+                                          const AutomatonIndex &base_index,
+                                          const Automaton &plan_ta,
+                                          const AutomatonIndex &plan_index) {
   std::vector<std::string> res;
-  std::string source_id = trace_to_ta_ids[trans.source_id];
-  std::string dest_id = trace_to_ta_ids[trans.dest_id];
+  const StateId &source_id = StateId::of(trace_to_ta_ids[trans.source_id]);
+  const StateId &dest_id = StateId::of(trace_to_ta_ids[trans.dest_id]);
   std::string guard_str = trans.guard.get()->toString();
   std::string update_str = trans.updateToString();
   std::string sync_str = trans.sync;
   // obtain action name
-  string pa_source_id = Filter::getPrefix(source_id, constants::TL_SEP);
-  string pa_dest_id = Filter::getPrefix(dest_id, constants::TL_SEP);
+  const Symbol &pa_source_id = source_id.plan_action;
+  const Symbol &pa_dest_id = dest_id.plan_action;
   if (pa_dest_id == constants::QUERY) {
     return res;
   }
   if (pa_source_id != pa_dest_id) {
-    auto pa_trans = ::std::find_if(
-        plan_ta.transitions.begin(), plan_ta.transitions.end(),
-        [pa_source_id, pa_dest_id, guard_str, sync_str,
-         update_str](const Transition &t) {
-          return t.source_id == pa_source_id && t.dest_id == pa_dest_id &&
+    auto pa_out = plan_index.outgoing(pa_source_id);
+    auto pa_trans_pos = ::std::find_if(
+        pa_out.begin(), pa_out.end(),
+        [&plan_ta, &pa_dest_id, &guard_str, &sync_str,
+         &update_str](size_t pos) {
+          const Transition &t = plan_ta.transitions[pos];
+          return t.dest_id == pa_dest_id &&
                  guard_str.find(t.guard.get()->toString()) != string::npos &&
                  sync_str.find(t.sync) != string::npos &&
                  update_str.find(t.updateToString()) != string::npos;
         });
-    if (pa_trans == plan_ta.transitions.end()) {
+    if (pa_trans_pos == pa_out.end()) {
       cout << "ERROR:  cannot find plan ta transition: " << pa_source_id
            << " -> " << pa_dest_id << " {" << guard_str << "; " << sync_str
            << "; " << update_str << "}" << endl;
-    } else if (pa_trans->action != "") {
-      res.push_back(pa_trans->action);
     } else {
-      res.push_back("(" + pa_trans->source_id + " -> " + pa_trans->dest_id +
-                    ")");
+      const Transition &pa_trans = plan_ta.transitions[*pa_trans_pos];
+      if (pa_trans.action != "") {
+        res.push_back(pa_trans.action);
+      } else {
+        res.push_back("(" + pa_trans.source_id + " -> " + pa_trans.dest_id +
+                      ")");
+      }
     }
   }
-  string base_source_id = Filter::getSuffix(source_id, constants::BASE_SEP);
-  string base_dest_id = Filter::getSuffix(dest_id, constants::BASE_SEP);
-  auto base_trans = ::std::find_if(
-      base_ta.transitions.begin(), base_ta.transitions.end(),
-      [base_source_id, base_dest_id, guard_str, sync_str,
-       update_str](const Transition &t) {
-        return t.source_id == base_source_id &&
-               t.dest_id.find(base_dest_id) != string::npos &&
+  const Symbol &base_source_id = source_id.base;
+  const std::string &base_dest_id = dest_id.base;
+  auto base_out = base_index.outgoing(base_source_id);
+  auto base_trans_pos = ::std::find_if(
+      base_out.begin(), base_out.end(),
+      [&base_ta, &base_dest_id, &guard_str, &sync_str,
+       &update_str](size_t pos) {
+        const Transition &t = base_ta.transitions[pos];
+        return t.dest_id.str().find(base_dest_id) != string::npos &&
                isPiecewiseContained(t.guard.get()->toString(), guard_str,
                                     constants::CC_CONJUNCTION) &&
                sync_str.find(t.sync) != string::npos &&
                isPiecewiseContained(t.updateToString(), update_str,
                                     constants::UPDATE_CONJUNCTION);
       });
-  if (base_trans == base_ta.transitions.end()) {
+  if (base_trans_pos == base_out.end()) {
     if (base_source_id != base_dest_id) {
       cout << "ERROR:  cannot find base ta transition: " << base_source_id
            << " -> " << base_dest_id << " {" << guard_str << "; " << sync_str
            << "; " << update_str << "}" << endl;
     }
   } else {
+    auto base_trans = base_ta.transitions.begin() + *base_trans_pos;
     std::vector<std::string> action_vec =
         splitBySep(base_trans->action, constants::ACTION_SEP);
     std::vector<std::string> source_vec =
@@ -371,9 +397,7 @@ timed_trace_t UTAPTraceParser::applyDelay(size_t delay_pos, timepoint delay) {
         << std::endl;
     return timed_trace_t();
   }
-  auto global_clock_it = std::find_if(
-      trace_ta.clocks.begin(), trace_ta.clocks.end(),
-      [](const auto &cl) { return cl.get()->id == constants::GLOBAL_CLOCK; });
+  auto global_clock_it = trace_ta.clocks.find(constants::GLOBAL_CLOCK);
   if (global_clock_it != trace_ta.clocks.end()) {
     for (size_t trans_offset = 0; trans_offset <= delay_pos; trans_offset++) {
       auto ta_trans_it = trace_ta.transitions.begin() + trans_offset;
@@ -383,7 +407,7 @@ timed_trace_t UTAPTraceParser::applyDelay(size_t delay_pos, timepoint delay) {
         execute_at =
             (parsed_trace.begin() + trans_offset)->first.earliest_start + delay;
       }
-      ta_trans_it->guard = std::make_unique<ConjunctionCC>(
+      ta_trans_it->guard = addConstraint(
           *ta_trans_it->guard.get(),
           ComparisonCC(*global_clock_it, ComparisonOp::GTE, execute_at));
     }
@@ -391,9 +415,8 @@ timed_trace_t UTAPTraceParser::applyDelay(size_t delay_pos, timepoint delay) {
     trace_system.instances.push_back(std::make_pair(trace_ta, ""));
     std::string query_str =
         "E<> sys_" + trace_ta.prefix + "." + trace_ta.states.back().id;
-    uppaalcalls::solve(trace_system, "trace_ta", query_str);
     ta_to_symbolic_state.clear();
-    parseTraceInfo("trace_ta.trace");
+    solveTrace(trace_system, "trace_ta", query_str);
 
     for (auto &cl_val : curr_clock_values) {
       cl_val.second = std::make_pair(0, false);
@@ -493,6 +516,8 @@ timed_trace_t UTAPTraceParser::getTimedTrace(const Automaton &base_ta,
                                              const Automaton &plan_ta) {
   std::vector<SpecialClocksInfo> trace_timings = getTraceTimings();
   timed_trace_t res;
+  AutomatonIndex base_index(base_ta);
+  AutomatonIndex plan_index(plan_ta);
   assert(trace_timings.size() == trace_ta.transitions.size() + 1);
   // the last transition goes to fin, hence we skip it
   for (size_t i = 0; i < trace_ta.transitions.size() - 1; i++) {
@@ -515,7 +540,7 @@ timed_trace_t UTAPTraceParser::getTimedTrace(const Automaton &base_ta,
     res.push_back(std::make_pair(
         curr_action_grounding,
         getActionsFromTraceTrans(*(trace_ta.transitions.begin() + i), base_ta,
-                                 plan_ta)));
+                                 base_index, plan_ta, plan_index)));
   }
   parsed_trace = res;
   return res;
@@ -573,13 +598,92 @@ bool UTAPTraceParser::parseTraceInfo(const std::string &file) {
   return true;
 }
 
+bool UTAPTraceParser::parseTrace(const SymbolicTrace &trace) {
+  if (trace.states.size() != trace.transitions.size() + 1) {
+    std::cout << "UTAPTraceParser parseTrace: trace not valid" << std::endl;
+    return false;
+  }
+  ingestState(trace.states.front().state_id, trace.states.front().zone);
+  for (size_t i = 0; i < trace.transitions.size(); i++) {
+    const Transition &trans = trace.transitions[i];
+    ingestTransition(trans.source_id, trans.dest_id, trans.guard, trans.update,
+                     trans.sync);
+    ingestState(trace.states[i + 1].state_id, trace.states[i + 1].zone);
+  }
+  parsed = true;
+  return true;
+}
+
+namespace {
+/** @return solver selected by the environment variable TAPTENC_SOLVER */
+std::string solverName() {
+  const char *solver_env = std::getenv("TAPTENC_SOLVER");
+  return (solver_env == nullptr) ? "" : solver_env;
+}
+} // end anonymous namespace
+
+std::string UTAPTraceParser::solverConfiguration() {
+  std::string solver_name = solverName();
+  if (solver_name == "portfolio") {
+    std::string res = "portfolio";
+    for (const auto &config : uppaalcalls::defaultPortfolio()) {
+      res += " " + config.name + ":" + config.options;
+    }
+    return res;
+  }
+  std::string res = "verifyta " + std::string(uppaalcalls::SOLVE_OPTIONS);
+  if (solver_name != "verifyta") {
+    res = "zone solver, fallback " + res;
+  }
+  return res;
+}
+
+bool UTAPTraceParser::fastestTrace() const { return fastest_trace; }
+
+bool UTAPTraceParser::solveTrace(const AutomataSystem &s,
+                                 const std::string &file_name,
+                                 const std::string &query_str) {
+  std::string solver_name = solverName();
+  fastest_trace = true;
+  if (solver_name != "verifyta" && solver_name != "portfolio") {
+    ZoneSolver solver(s, query_str);
+    SymbolicTrace trace;
+    switch (solver.solve(trace)) {
+    case ReachabilityResult::Reachable:
+      return parseTrace(trace);
+    case ReachabilityResult::Unreachable:
+      std::cout << "UTAPTraceParser solveTrace: query not satisfied"
+                << std::endl;
+      return false;
+    default:
+      std::cout << "UTAPTraceParser solveTrace: fall back to verifyta, "
+                << solver.unsupportedReason() << std::endl;
+    }
+  }
+  uppaalcalls::SolverSession session;
+  if (solver_name == "portfolio") {
+    std::vector<uppaalcalls::SolverConfig> configs =
+        uppaalcalls::defaultPortfolio();
+    uppaalcalls::PortfolioResult res = uppaalcalls::solvePortfolio(
+        s, session.path(file_name), query_str, configs);
+    if (!res.satisfied) {
+      return false;
+    }
+    fastest_trace =
+        configs[res.winner].options == uppaalcalls::SOLVE_OPTIONS;
+  } else {
+    uppaalcalls::solve(s, session.path(file_name), query_str);
+  }
+  return parseTraceInfo(session.path(file_name) + ".trace");
+}
+
 UTAPTraceParser::UTAPTraceParser(const AutomataSystem &s)
     : trace_ta(Automaton({}, {}, "trace_ta", false)) {
-  trace_ta.clocks.insert(s.globals.clocks.begin(), s.globals.clocks.end());
+  trace_ta.clocks |= s.globals.clocks;
   for (const auto &ta : s.instances) {
     source_states.insert(source_states.begin(), ta.first.states.begin(),
                          ta.first.states.end());
-    trace_ta.clocks.insert(ta.first.clocks.begin(), ta.first.clocks.end());
+    trace_ta.clocks |= ta.first.clocks;
   }
   for (const auto &cl : trace_ta.clocks) {
     curr_clock_values.insert(std::make_pair(cl, std::make_pair(0, false)));
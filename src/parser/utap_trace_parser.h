@@ -56,6 +56,27 @@ typedef ::std::vector<
     ::std::pair<groundedActionTime, ::std::vector<::std::string>>>
     timed_trace_t;
 
+/**
+ * Symbolic state of a trace.
+ */
+struct symbolicState {
+  /** Id of the state in the automaton the trace belongs to. */
+  ::std::string state_id;
+  /** Clock zone of the state after delaying, the reference clock is t(0). */
+  dbm_t zone;
+};
+typedef struct symbolicState SymbolicState;
+
+/**
+ * Symbolic trace of an automaton, transitions[i] leads from states[i] to
+ * states[i+1].
+ */
+struct symbolicTrace {
+  ::std::vector<SymbolicState> states;
+  ::std::vector<Transition> transitions;
+};
+typedef struct symbolicTrace SymbolicTrace;
+
 class UTAPTraceParser {
 
 public:
@@ -70,6 +91,51 @@ public:
    * @return true iff parsing was successful
    */
   bool parseTraceInfo(const ::std::string &file);
+  /**
+   * Parses a symbolic trace that was obtained without calling uppaal (see
+   * ZoneSolver).
+   *
+   * @param trace symbolic trace of an automaton from the system this parser
+   *              was created with
+   * @return true iff parsing was successful
+   */
+  bool parseTrace(const SymbolicTrace &trace);
+  /**
+   * Solves a reachability query and parses the resulting trace.
+   *
+   * The query is solved in-process by a ZoneSolver. Systems that it does not
+   * support are solved by verifyta (see uppaalcalls::solve()), which is also
+   * used if the environment variable TAPTENC_SOLVER is set to "verifyta".
+   * Setting it to "portfolio" races several verifyta configurations instead
+   * (see uppaalcalls::solvePortfolio()).
+   *
+   * @param s system to solve the query for
+   * @param file_name name of the files written for verifyta (without
+   *                  extension), they are placed in the directory of a
+   *                  fresh uppaalcalls::SolverSession
+   * @param query_str reachability query of the form E<> sys_ta.state
+   * @return true iff the query is satisfied and the trace was parsed
+   */
+  bool solveTrace(const AutomataSystem &s, const ::std::string &file_name,
+                  const ::std::string &query_str);
+  /**
+   * Describes the solvers that solveTrace() uses in the current environment.
+   *
+   * Results of different configurations may differ, e.g. only some solvers
+   * yield the fastest trace.
+   *
+   * @return description of the solver configuration
+   */
+  static ::std::string solverConfiguration();
+  /**
+   * Tells whether the last trace obtained by solveTrace() is a fastest trace.
+   *
+   * Portfolio configurations other than the fastest one answer with arbitrary
+   * traces, which differ between runs.
+   *
+   * @return true iff the trace is a fastest trace
+   */
+  bool fastestTrace() const;
 
   /**
    * Applies a delay to the concrete trace and calculates a new temporal trace
@@ -93,6 +159,7 @@ public:
 
 private:
   bool parsed = false;
+  bool fastest_trace = true;
   Automaton trace_ta;
   std::unordered_map<std::string, std::string> trace_to_ta_ids;
   std::vector<State> source_states;
@@ -112,13 +179,17 @@ private:
    *
    * @param trans trace transition from trace_ta
    * @param base_ta platform TA that was used in the encoding
+   * @param base_index adjacency index of \a base_ta
    * @param plan_ta plan automaton used in the encoding
+   * @param plan_index adjacency index of \a plan_ta
    * @return all actions that are attached to the platform and plan TA
    *         transitions causing the trace transition
    */
   ::std::vector<::std::string>
   getActionsFromTraceTrans(const Transition &trans, const Automaton &base_ta,
-                           const Automaton &plan_ta);
+                           const AutomatonIndex &base_index,
+                           const Automaton &plan_ta,
+                           const AutomatonIndex &plan_index);
   /**
    * Adds a fresh state to the trace TA.
    *
@@ -149,5 +220,24 @@ private:
    * @param currentReadLine line from a .trace file containing state info
    */
   void parseState(std::string &currentReadLine);
+  /**
+   * Adds a symbolic state to the parsed trace.
+   *
+   * @param state_id id of the state
+   * @param zone clock zone of the state
+   */
+  void ingestState(const ::std::string &state_id, const dbm_t &zone);
+  /**
+   * Adds a transition to the parsed trace.
+   *
+   * @param source_id id of the source state
+   * @param dest_id id of the destination state
+   * @param guard guard of the transition
+   * @param update clocks reset by the transition
+   * @param sync synchronization label of the transition
+   */
+  void ingestTransition(const ::std::string &source_id,
+                        const ::std::string &dest_id, const FlatCCPtr &guard,
+                        const update_t &update, const ::std::string &sync);
 };
 } // end namespace taptenc
@@ -229,7 +229,7 @@ AutomataSystem utapxmlparser::readXMLSystem(::std::string filename) {
                      curr_updates, tr.sync.toString()));
     }
     Automaton curr_ta(states, transitions, t.uid.getName(), false);
-    curr_ta.clocks.insert(curr_clocks.begin(), curr_clocks.end());
+    curr_ta.clocks |= curr_clocks;
     res.instances.push_back(std::make_pair(curr_ta, ""));
   }
   auto vars = input_system.getGlobals().variables;
@@ -14,7 +14,9 @@
 #include <assert.h>
 #include <chrono>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -31,7 +33,7 @@ using namespace std;
 
 void append_prefix_to_states(vector<State> &arg_states, string prefix) {
   for (auto it = arg_states.begin(); it != arg_states.end(); ++it) {
-    it->id += prefix;
+    it->id = it->id + prefix;
   }
 }
 
@@ -82,7 +84,7 @@ Automaton generateSyncPlanAutomaton(
     std::unique_ptr<ClockConstraint> guard;
     update_t update = {};
     auto prev_state = (it - 1);
-    if (prev_state->id.substr(0, 5) != "alpha") {
+    if (prev_state->id.str().substr(0, 5) != "alpha") {
       sync_op = Filter::getPrefix(prev_state->id, constants::PA_SEP);
       guard = std::make_unique<TrueCC>();
     } else {
@@ -443,18 +445,50 @@ int main(int argc, char **argv) {
 
   XMLPrinter printer;
   vector<uppaalcalls::timedelta> time_observed;
+  // the next plan is encoded while the previous ones are solved, at most as
+  // many encodings as the pool solves at once wait for a solver
+  uppaalcalls::SolverPool solver_pool;
+  deque<future<timed_trace_t>> results;
+  auto printNextResult = [&results]() {
+    try {
+      timed_trace_t res = results.front().get();
+      for (const auto &entry : res) {
+        std::cout << entry.first << " : ";
+        for (const auto &act : entry.second) {
+          std::cout << act << " ";
+        }
+        std::cout << std::endl;
+      }
+    } catch (const std::exception &e) {
+      std::cout << "plan failed: " << e.what() << std::endl;
+    }
+    results.pop_front();
+  };
+  // the symbols created for the plans are released once all submitted plans
+  // are done, which is enforced after every symbol_release_interval plans
+  const int symbol_release_interval = 16;
+  Symbol::Checkpoint plan_symbols = Symbol::checkpoint();
   for (int k = 0; k < num_runs_per_category; k++) {
-		// init plan
+    if (k > 0 && k % symbol_release_interval == 0) {
+      while (!results.empty()) {
+        printNextResult();
+      }
+      Symbol::release(plan_symbols);
+    } else if (results.size() >= solver_pool.size()) {
+      printNextResult();
+    }
+    // init plan
     vector<PlanAction> plan = generatePlan(plan_length);
-		auto res = taptenc::transformation::transform_plan(plan, platform_tas, platform_constraints);
-		for ( const auto &entry : res ) {
-		  std::cout << entry.first << " : ";
-		 for (const auto &act : entry.second) {
-			   std::cout	<< act << " ";
-		 }
-		 std::cout << std::endl;
-		}
-	}
+    try {
+      results.push_back(taptenc::transformation::transform_plan_async(
+          plan, platform_tas, platform_constraints, solver_pool));
+    } catch (const BudgetExceededError &e) {
+      std::cout << "skip plan: " << e.what() << std::endl;
+    }
+  }
+  while (!results.empty()) {
+    printNextResult();
+  }
 
 	// 	AutomataSystem merged_system;
   //   DirectEncoder merge_enc;
@@ -0,0 +1,108 @@
+/** \file
+ * Difference bound matrices to represent clock zones.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "dbm.h"
+#include <algorithm>
+
+using namespace taptenc;
+
+DBM::DBM(std::size_t dim) : dim(dim), m(dim * dim, LE_ZERO) {}
+
+void DBM::up() {
+  for (std::size_t i = 1; i < dim; i++) {
+    get(i, 0) = INF;
+  }
+}
+
+/**
+ * \internal
+ * As the matrix is canonical, tightening one entry only requires to update
+ * the paths through the changed edge.
+ * \endinternal
+ */
+bool DBM::constrain(std::size_t i, std::size_t j, raw_t raw) {
+  if (isEmpty()) {
+    return false;
+  }
+  if (raw >= at(i, j)) {
+    return true;
+  }
+  if (add(raw, at(j, i)) < LE_ZERO) {
+    get(0, 0) = bound(-1, false);
+    return false;
+  }
+  get(i, j) = raw;
+  for (std::size_t k = 0; k < dim; k++) {
+    raw_t via_i = add(at(k, i), raw);
+    if (via_i == INF) {
+      continue;
+    }
+    for (std::size_t l = 0; l < dim; l++) {
+      raw_t path = add(via_i, at(j, l));
+      if (path < at(k, l)) {
+        get(k, l) = path;
+      }
+    }
+  }
+  return true;
+}
+
+void DBM::reset(std::size_t x) {
+  for (std::size_t j = 0; j < dim; j++) {
+    get(x, j) = at(0, j);
+    get(j, x) = at(j, 0);
+  }
+  get(x, x) = LE_ZERO;
+}
+
+void DBM::extrapolate(const std::vector<timepoint> &max_constants) {
+  if (isEmpty()) {
+    return;
+  }
+  bool changed = false;
+  for (std::size_t i = 0; i < dim; i++) {
+    for (std::size_t j = 0; j < dim; j++) {
+      if (i == j || at(i, j) == INF) {
+        continue;
+      }
+      if (i != 0 && at(i, j) > bound(max_constants[i], false)) {
+        get(i, j) = INF;
+        changed = true;
+      } else if (j != 0 && at(i, j) < bound(-max_constants[j], true)) {
+        get(i, j) = bound(-max_constants[j], true);
+        changed = true;
+      }
+    }
+  }
+  if (changed) {
+    close();
+  }
+}
+
+bool DBM::includes(const DBM &other) const {
+  if (other.isEmpty()) {
+    return true;
+  }
+  return std::equal(m.begin(), m.end(), other.m.begin(),
+                    [](raw_t a, raw_t b) { return a >= b; });
+}
+
+void DBM::close() {
+  for (std::size_t k = 0; k < dim; k++) {
+    for (std::size_t i = 0; i < dim; i++) {
+      raw_t via_k = at(i, k);
+      if (via_k == INF) {
+        continue;
+      }
+      for (std::size_t j = 0; j < dim; j++) {
+        raw_t path = add(via_k, at(k, j));
+        if (path < at(i, j)) {
+          get(i, j) = path;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,116 @@
+/** \file
+ * Difference bound matrices to represent clock zones.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include "../constraints/constraints.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace taptenc {
+/**
+ * Difference bound matrix (DBM) over a fixed number of clocks.
+ *
+ * Entry (i,j) bounds the difference x_i - x_j of two clocks, where x_0 is the
+ * reference clock that is always 0. Bounds are stored as raw values that
+ * encode the constant together with the strictness, such that the order of
+ * raw values matches the order of the bounds (see bound()).
+ *
+ * All operations keep the matrix in canonical (closed) form.
+ */
+class DBM {
+public:
+  /** Raw bound, (constant << 1) | (1 if non-strict). */
+  typedef ::std::int64_t raw_t;
+  /** Raw value of the bound < infinity. */
+  static constexpr raw_t INF = ::std::numeric_limits<raw_t>::max();
+  /** Raw value of the bound <= 0. */
+  static constexpr raw_t LE_ZERO = 1;
+
+  /**
+   * Encodes a bound.
+   *
+   * @param constant constant of the bound
+   * @param strict true for <, false for <=
+   * @return raw value of the bound
+   */
+  static raw_t bound(timepoint constant, bool strict) {
+    // multiply instead of shifting, shifting negative values is undefined
+    return static_cast<raw_t>(constant) * 2 + (strict ? 0 : 1);
+  }
+  /** @return constant of a finite raw bound */
+  static timepoint constant(raw_t raw) {
+    return static_cast<timepoint>(raw >> 1);
+  }
+  /** @return true iff a raw bound is strict */
+  static bool isStrict(raw_t raw) { return (raw & 1) == 0; }
+  /** @return raw bound of the sum of two bounds */
+  static raw_t add(raw_t a, raw_t b) {
+    if (a == INF || b == INF) {
+      return INF;
+    }
+    return ((a & ~raw_t(1)) + (b & ~raw_t(1))) | (a & b & 1);
+  }
+
+  /**
+   * Creates the zone where all clocks are 0.
+   *
+   * @param dim number of clocks including the reference clock
+   */
+  explicit DBM(::std::size_t dim);
+
+  /** @return number of clocks including the reference clock */
+  ::std::size_t dimension() const { return dim; }
+  /** @return raw bound on x_i - x_j */
+  raw_t at(::std::size_t i, ::std::size_t j) const { return m[i * dim + j]; }
+  /** @return true iff the zone contains no clock valuation */
+  bool isEmpty() const { return m[0] < LE_ZERO; }
+
+  /** Lets time elapse by removing all upper bounds of clocks. */
+  void up();
+  /**
+   * Intersects the zone with the constraint x_i - x_j <(=) c.
+   *
+   * @param i index of the minuend
+   * @param j index of the subtrahend
+   * @param raw raw bound of the constraint
+   * @return false iff the zone became empty
+   */
+  bool constrain(::std::size_t i, ::std::size_t j, raw_t raw);
+  /**
+   * Resets a clock to 0.
+   *
+   * @param x index of the clock
+   */
+  void reset(::std::size_t x);
+  /**
+   * Applies the maximal bounds extrapolation, so the zone graph becomes
+   * finite.
+   *
+   * The extrapolation preserves reachability of states as long as no
+   * difference constraints are used.
+   *
+   * @param max_constants largest constant each clock is compared to (index 0
+   *                      belongs to the reference clock)
+   */
+  void extrapolate(const ::std::vector<timepoint> &max_constants);
+  /**
+   * @param other zone of the same dimension
+   * @return true iff \a other is a subset of this zone
+   */
+  bool includes(const DBM &other) const;
+
+private:
+  ::std::size_t dim;
+  ::std::vector<raw_t> m;
+
+  raw_t &get(::std::size_t i, ::std::size_t j) { return m[i * dim + j]; }
+  /** Restores the canonical form (Floyd-Warshall). */
+  void close();
+};
+} // end namespace taptenc
@@ -0,0 +1,517 @@
+/** \file
+ * In-process reachability checking on the zone graph of a timed automaton.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "zone_solver.h"
+#include "../constants.h"
+#include "../timed-automata/state_id.h"
+#include "../utils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <queue>
+
+using namespace taptenc;
+
+namespace {
+/** Transition taken on a path, linked to the previous step. */
+struct pathStep {
+  std::size_t trans;
+  std::shared_ptr<const struct pathStep> prev;
+};
+typedef std::shared_ptr<const struct pathStep> PathPtr;
+
+/** Node of the explored zone graph. */
+struct zoneNode {
+  std::size_t state;
+  DBM zone;
+  /** Last step of the path leading to the node, nullptr for the root. */
+  PathPtr path;
+  /** True if a node with a larger zone of the same state was found. */
+  bool covered;
+};
+typedef struct zoneNode ZoneNode;
+
+/**
+ * Zones of one layer, each state has a passed list of zones of which none
+ * includes another one.
+ */
+struct zoneLayer {
+  std::vector<ZoneNode> nodes;
+  /** Positions of the uncovered nodes of each state. */
+  std::unordered_map<std::size_t, std::vector<std::size_t>> passed;
+  /** Number of uncovered nodes. */
+  std::size_t size = 0;
+  /**
+   * Smallest lower bound of the global clock of all added nodes, covered
+   * ones included.
+   */
+  timepoint earliest = std::numeric_limits<timepoint>::max();
+
+  /**
+   * @param state state of a zone
+   * @param zone zone to check
+   * @return true iff a stored zone of \a state includes \a zone
+   */
+  bool includes(std::size_t state, const DBM &zone) const {
+    auto state_passed = passed.find(state);
+    return state_passed != passed.end() &&
+           std::any_of(state_passed->second.begin(),
+                       state_passed->second.end(), [this, &zone](std::size_t n) {
+                         return nodes[n].zone.includes(zone);
+                       });
+  }
+
+  /**
+   * Adds a node that is not included in a stored zone (see includes()),
+   * stored zones included in the new one are marked as covered.
+   *
+   * @param node node to add
+   * @return position of \a node
+   */
+  std::size_t add(ZoneNode &&node) {
+    std::vector<std::size_t> &state_passed = passed[node.state];
+    state_passed.erase(
+        std::remove_if(state_passed.begin(), state_passed.end(),
+                       [this, &node](std::size_t n) {
+                         if (node.zone.includes(nodes[n].zone)) {
+                           nodes[n].covered = true;
+                           size--;
+                           return true;
+                         }
+                         return false;
+                       }),
+        state_passed.end());
+    state_passed.push_back(nodes.size());
+    nodes.push_back(std::move(node));
+    size++;
+    return nodes.size() - 1;
+  }
+};
+typedef struct zoneLayer ZoneLayer;
+} // end anonymous namespace
+
+ZoneSolver::ZoneSolver(const AutomataSystem &s, const std::string &query_str) {
+  if (s.instances.size() != 1) {
+    unsupported = "only systems with a single automaton are supported";
+    return;
+  }
+  ta = &s.instances[0].first;
+  if (ta->states.empty()) {
+    unsupported = "automaton has no states";
+    return;
+  }
+  if (std::none_of(ta->states.begin(), ta->states.end(),
+                   [](const State &st) { return st.initial; })) {
+    unsupported = "automaton has no initial state";
+    return;
+  }
+  std::string query = trim(query_str);
+  std::size_t sep = query.find('.');
+  if (query.compare(0, 3, "E<>") != 0 || sep == std::string::npos ||
+      trim(query.substr(3, sep - 3)) != "sys_" + ta->prefix) {
+    unsupported = "unsupported query " + query_str;
+    return;
+  }
+  AutomatonIndex index(*ta);
+  goal = index.stateIndex(trim(query.substr(sep + 1)));
+  if (goal == AutomatonIndex::npos) {
+    unsupported = "unknown state in query " + query_str;
+    return;
+  }
+  // index 0 is the reference clock
+  clock_names.push_back("t(0)");
+  ClockSet clocks = s.globals.clocks;
+  clocks |= ta->clocks;
+  for (const auto &cl : clocks) {
+    clock_index.insert(std::make_pair(cl->id, clock_names.size()));
+    if (cl->id == constants::GLOBAL_CLOCK) {
+      global_clock = clock_names.size();
+    }
+    clock_names.push_back(cl->id);
+  }
+  max_constants.resize(clock_names.size(), 0);
+  for (const auto &st : ta->states) {
+    invariants.emplace_back();
+    if (!translate(*st.inv, invariants.back())) {
+      return;
+    }
+  }
+  std::unordered_map<std::string, ChanType> channels;
+  for (const auto &chan : s.globals.channels) {
+    channels.insert(std::make_pair(chan.name, chan.type));
+  }
+  outgoing.resize(ta->states.size());
+  for (std::size_t i = 0; i < ta->transitions.size(); i++) {
+    const Transition &trans = ta->transitions[i];
+    guards.emplace_back();
+    resets.emplace_back();
+    destinations.push_back(index.stateIndex(trans.dest_id));
+    if (!translate(*trans.guard, guards.back())) {
+      return;
+    }
+    for (const auto &cl : trans.update) {
+      auto reset = clock_index.find(cl->id);
+      if (reset == clock_index.end()) {
+        unsupported = "unknown clock " + cl->id.str();
+        return;
+      }
+      if (global_clock != 0 && reset->second == global_clock) {
+        // the search order relies on the global clock measuring total time
+        unsupported = "reset of the global clock";
+        return;
+      }
+      resets.back().push_back(reset->second);
+    }
+    std::size_t source = index.stateIndex(trans.source_id);
+    if (source == AutomatonIndex::npos ||
+        destinations.back() == AutomatonIndex::npos) {
+      continue;
+    }
+    if (trans.sync != "") {
+      auto chan = channels.find(trans.sync);
+      if (chan == channels.end()) {
+        unsupported = "undeclared channel " + trans.sync;
+        return;
+      }
+      // without other automata only broadcast emitters can fire
+      if (trans.passive || chan->second != ChanType::Broadcast) {
+        continue;
+      }
+    }
+    outgoing[source].push_back(i);
+  }
+  computeLayers();
+}
+
+bool ZoneSolver::translate(const FlatCC &cc, ZoneConstraints &res) {
+  for (const auto &atom : cc.atoms) {
+    std::size_t i = 0;
+    std::size_t j = 0;
+    if (atom.type == CCType::UNPARSED) {
+      if (trim(atom.lhs.str()) == "") {
+        continue;
+      }
+      unsupported = "unparsed constraint " + atom.lhs.str();
+      return false;
+    }
+    auto lhs = clock_index.find(atom.lhs);
+    if (lhs == clock_index.end()) {
+      unsupported = "unknown clock " + atom.lhs.str();
+      return false;
+    }
+    i = lhs->second;
+    if (atom.type == CCType::DIFFERENCE) {
+      auto rhs = clock_index.find(atom.rhs);
+      if (rhs == clock_index.end()) {
+        unsupported = "unknown clock " + atom.rhs.str();
+        return false;
+      }
+      j = rhs->second;
+    }
+    if (atom.constant == std::numeric_limits<timepoint>::max()) {
+      if (atom.comp == ComparisonOp::LT || atom.comp == ComparisonOp::LTE) {
+        // bounded by infinity
+        continue;
+      }
+    } else {
+      timepoint k = std::abs(atom.constant);
+      max_constants[i] = std::max(max_constants[i], k);
+      max_constants[j] = std::max(max_constants[j], k);
+    }
+    switch (atom.comp) {
+    case ComparisonOp::LTE:
+      res.push_back({i, j, DBM::bound(atom.constant, false)});
+      break;
+    case ComparisonOp::LT:
+      res.push_back({i, j, DBM::bound(atom.constant, true)});
+      break;
+    case ComparisonOp::GTE:
+      res.push_back({j, i, DBM::bound(-atom.constant, false)});
+      break;
+    case ComparisonOp::GT:
+      res.push_back({j, i, DBM::bound(-atom.constant, true)});
+      break;
+    case ComparisonOp::EQ:
+      res.push_back({i, j, DBM::bound(atom.constant, false)});
+      res.push_back({j, i, DBM::bound(-atom.constant, false)});
+      break;
+    default:
+      unsupported = "unsupported constraint " + atom.toString();
+      return false;
+    }
+  }
+  // the reference clock is never compared
+  max_constants[0] = 0;
+  return true;
+}
+
+bool ZoneSolver::apply(DBM &zone, const ZoneConstraints &constraints) {
+  for (const auto &c : constraints) {
+    if (!zone.constrain(c.i, c.j, c.raw)) {
+      return false;
+    }
+  }
+  return !zone.isEmpty();
+}
+
+DBM ZoneSolver::initialZone(std::size_t state) const {
+  DBM res(clock_names.size());
+  if (apply(res, invariants[state]) && !ta->states[state].urgent) {
+    res.up();
+    apply(res, invariants[state]);
+  }
+  return res;
+}
+
+bool ZoneSolver::post(DBM &zone, std::size_t trans) const {
+  if (!apply(zone, guards[trans])) {
+    return false;
+  }
+  for (std::size_t x : resets[trans]) {
+    zone.reset(x);
+  }
+  std::size_t dest = destinations[trans];
+  if (!apply(zone, invariants[dest])) {
+    return false;
+  }
+  if (!ta->states[dest].urgent) {
+    zone.up();
+    apply(zone, invariants[dest]);
+  }
+  return !zone.isEmpty();
+}
+
+dbm_t ZoneSolver::toDbmT(const DBM &zone) const {
+  dbm_t res;
+  for (std::size_t i = 0; i < zone.dimension(); i++) {
+    for (std::size_t j = 0; j < zone.dimension(); j++) {
+      DBM::raw_t raw = zone.at(i, j);
+      if (i != j && raw != DBM::INF) {
+        res.insert(std::make_pair(
+            std::make_pair(clock_names[i].str(), clock_names[j].str()),
+            std::make_pair(DBM::constant(raw), DBM::isStrict(raw))));
+      }
+    }
+  }
+  return res;
+}
+
+bool ZoneSolver::buildTrace(std::size_t initial,
+                            const std::vector<std::size_t> &path,
+                            SymbolicTrace &trace) const {
+  trace = SymbolicTrace();
+  DBM zone = initialZone(initial);
+  trace.states.push_back({ta->states[initial].id, toDbmT(zone)});
+  for (std::size_t trans : path) {
+    if (!post(zone, trans)) {
+      return false;
+    }
+    trace.transitions.push_back(ta->transitions[trans]);
+    trace.states.push_back({ta->states[destinations[trans]].id, toDbmT(zone)});
+  }
+  return true;
+}
+
+/**
+ * \internal
+ * States are grouped by the plan action part of their ids. If every
+ * transition between groups leads to a later group (ignoring the queried
+ * state), each state is assigned the length of the longest chain of groups
+ * before its own. Otherwise all states share one layer.
+ * \endinternal
+ */
+void ZoneSolver::computeLayers() {
+  std::unordered_map<Symbol, std::size_t> group_ids;
+  std::vector<std::size_t> groups;
+  for (const auto &st : ta->states) {
+    groups.push_back(
+        group_ids
+            .insert(std::make_pair(StateId::of(st.id).plan_action,
+                                   group_ids.size()))
+            .first->second);
+  }
+  std::vector<std::vector<std::size_t>> successors(group_ids.size());
+  std::vector<std::size_t> num_predecessors(group_ids.size(), 0);
+  for (std::size_t source = 0; source < outgoing.size(); source++) {
+    for (std::size_t trans : outgoing[source]) {
+      std::size_t dest = destinations[trans];
+      if (source != goal && dest != goal && groups[source] != groups[dest]) {
+        successors[groups[source]].push_back(groups[dest]);
+        num_predecessors[groups[dest]]++;
+      }
+    }
+  }
+  // longest paths by processing the groups in topological order
+  std::vector<std::size_t> group_layers(group_ids.size(), 0);
+  std::vector<std::size_t> ready;
+  for (std::size_t g = 0; g < group_ids.size(); g++) {
+    if (num_predecessors[g] == 0) {
+      ready.push_back(g);
+    }
+  }
+  std::size_t num_sorted = 0;
+  while (!ready.empty()) {
+    std::size_t g = ready.back();
+    ready.pop_back();
+    num_sorted++;
+    for (std::size_t succ : successors[g]) {
+      group_layers[succ] = std::max(group_layers[succ], group_layers[g] + 1);
+      if (--num_predecessors[succ] == 0) {
+        ready.push_back(succ);
+      }
+    }
+  }
+  layers.assign(ta->states.size(), 0);
+  num_layers = 1;
+  if (num_sorted < group_ids.size()) {
+    return;
+  }
+  for (std::size_t i = 0; i < ta->states.size(); i++) {
+    layers[i] = group_layers[groups[i]];
+    num_layers = std::max(num_layers, layers[i] + 1);
+  }
+}
+
+timepoint ZoneSolver::earliest(const DBM &zone) const {
+  return global_clock == 0 ? 0 : -DBM::constant(zone.at(0, global_clock));
+}
+
+/**
+ * \internal
+ * Layers are swept in ascending order. Within a layer the zone graph is
+ * searched best-first, ordered by the lower bound of the global clock (ties
+ * are broken breadth-first). A zone is skipped if a zone of the same state
+ * includes it, zones included in a newly found one are marked as covered and
+ * are not expanded. Zones entering later layers are collected in the same
+ * way until their layer is swept, zones of finished layers are released.
+ * Paths are stored as shared chains of steps, so only the steps leading to
+ * live zones are kept.
+ *
+ * Zones of the queried state join the queue of the current layer. Since the
+ * global clock is never reset, no zone reaches a lower bound below the one
+ * of the zone it is derived from. A dequeued goal zone is hence only
+ * returned once no queued zone of any layer has a smaller lower bound,
+ * otherwise it is kept as candidate until the search catches up. The
+ * returned trace thus reaches the queried state as early as possible.
+ *
+ * The trace is computed on the found path again without extrapolation, so
+ * it contains the exact zones.
+ * \endinternal
+ */
+ReachabilityResult ZoneSolver::solve(SymbolicTrace &trace) {
+  explored = 0;
+  peak_zones = 0;
+  if (unsupported != "") {
+    return ReachabilityResult::Unsupported;
+  }
+  auto initial_it =
+      std::find_if(ta->states.begin(), ta->states.end(),
+                   [](const State &st) { return st.initial; });
+  // existence is checked on construction
+  std::size_t initial = initial_it - ta->states.begin();
+  DBM initial_zone = initialZone(initial);
+  if (initial_zone.isEmpty()) {
+    return ReachabilityResult::Unreachable;
+  }
+  // zones of the current and of all later layers that were reached so far
+  std::map<std::size_t, ZoneLayer> reached;
+  reached[layers[initial]].earliest = earliest(initial_zone);
+  reached[layers[initial]].add(
+      {initial, std::move(initial_zone), nullptr, false});
+  std::size_t num_reached = 1;
+  // earliest goal zone found so far
+  bool goal_found = false;
+  timepoint goal_earliest = 0;
+  PathPtr goal_path;
+  auto returnGoal = [this, initial, &goal_path, &trace]() {
+    std::vector<std::size_t> path;
+    for (const pathStep *step = goal_path.get(); step != nullptr;
+         step = step->prev.get()) {
+      path.push_back(step->trans);
+    }
+    std::reverse(path.begin(), path.end());
+    if (!buildTrace(initial, path, trace)) {
+      unsupported = "extrapolation led to an infeasible trace";
+      return ReachabilityResult::Unsupported;
+    }
+    return ReachabilityResult::Reachable;
+  };
+  typedef std::pair<timepoint, std::size_t> QueueEntry;
+  while (!reached.empty()) {
+    std::size_t layer_index = reached.begin()->first;
+    ZoneLayer &layer = reached.begin()->second;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+                        std::greater<QueueEntry>>
+        waiting;
+    for (std::size_t n = 0; n < layer.nodes.size(); n++) {
+      if (!layer.nodes[n].covered) {
+        waiting.push(std::make_pair(earliest(layer.nodes[n].zone), n));
+      }
+    }
+    while (!waiting.empty()) {
+      if (goal_found && waiting.top().first >= goal_earliest &&
+          std::all_of(std::next(reached.begin()), reached.end(),
+                      [goal_earliest](const auto &later) {
+                        return later.second.earliest >= goal_earliest;
+                      })) {
+        return returnGoal();
+      }
+      std::size_t curr = waiting.top().second;
+      timepoint curr_earliest = waiting.top().first;
+      waiting.pop();
+      if (layer.nodes[curr].covered) {
+        continue;
+      }
+      explored++;
+      if (layer.nodes[curr].state == goal) {
+        if (!goal_found || curr_earliest < goal_earliest) {
+          goal_found = true;
+          goal_earliest = curr_earliest;
+          goal_path = layer.nodes[curr].path;
+        }
+        continue;
+      }
+      const DBM source_zone = layer.nodes[curr].zone;
+      const PathPtr source_path = layer.nodes[curr].path;
+      for (std::size_t trans : outgoing[layer.nodes[curr].state]) {
+        DBM zone = source_zone;
+        if (!post(zone, trans)) {
+          continue;
+        }
+        zone.extrapolate(max_constants);
+        std::size_t dest = destinations[trans];
+        // the queried state joins the current layer
+        ZoneLayer &dest_layer =
+            (dest == goal) ? layer : reached[layers[dest]];
+        if (dest_layer.includes(dest, zone)) {
+          continue;
+        }
+        timepoint dest_earliest = earliest(zone);
+        dest_layer.earliest = std::min(dest_layer.earliest, dest_earliest);
+        num_reached -= dest_layer.size;
+        std::size_t pos = dest_layer.add(
+            {dest, std::move(zone),
+             std::make_shared<const pathStep>(pathStep{trans, source_path}),
+             false});
+        num_reached += dest_layer.size;
+        peak_zones = std::max(peak_zones, num_reached);
+        if (&dest_layer == &layer) {
+          waiting.push(std::make_pair(dest_earliest, pos));
+        }
+      }
+    }
+    num_reached -= layer.size;
+    reached.erase(layer_index);
+  }
+  if (goal_found) {
+    return returnGoal();
+  }
+  return ReachabilityResult::Unreachable;
+}
@@ -0,0 +1,162 @@
+/** \file
+ * In-process reachability checking on the zone graph of a timed automaton.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include "../parser/utap_trace_parser.h"
+#include "../timed-automata/timed_automata.h"
+#include "dbm.h"
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace taptenc {
+enum ReachabilityResult {
+  /** The queried state is reachable, a trace is available. */
+  Reachable,
+  /** The queried state is not reachable. */
+  Unreachable,
+  /** The system or query cannot be handled by the solver. */
+  Unsupported
+};
+
+/**
+ * Checks reachability queries on systems with a single automaton (such as
+ * the final direct encoding) by exploring its zone graph.
+ *
+ * The direct encoding is layered by plan progress: transitions only lead
+ * from the timelines of a plan action to the timelines of the same or of a
+ * later plan action (or to the queried state). The solver detects such
+ * layers from the plan action part of the state ids (see StateId) and sweeps
+ * them in plan order, keeping only the zones of the current layer and the
+ * zones entering later layers. Systems without such layers are searched as
+ * a single layer.
+ *
+ * Within a layer symbolic states are explored in order of the lower bound of
+ * the global clock (see constants::GLOBAL_CLOCK). A trace is only returned
+ * once no zone of any layer that is still to be explored has a smaller lower
+ * bound, hence it reaches the queried state as early as possible (up to the
+ * largest constant the global clock is compared with), similar to the
+ * fastest trace of verifyta. Systems that reset the global clock are not
+ * supported.
+ *
+ * Supported are clock constraints (except !=), clock resets, urgent states
+ * and broadcast synchronizations, which cannot block a single automaton.
+ */
+class ZoneSolver {
+public:
+  /**
+   * Prepares solving a query.
+   *
+   * The system has to outlive the solver.
+   *
+   * @param s system to solve the query for
+   * @param query_str query of the form E<> sys_ta.state
+   */
+  ZoneSolver(const AutomataSystem &s, const ::std::string &query_str);
+
+  /**
+   * Solves the query.
+   *
+   * @param trace receives the trace to the queried state if it is reachable
+   * @return result of the query
+   */
+  ReachabilityResult solve(SymbolicTrace &trace);
+
+  /** @return reason why the solver cannot handle the system or query */
+  const ::std::string &unsupportedReason() const { return unsupported; }
+  /** @return number of symbolic states explored by the last call of solve() */
+  ::std::size_t numExploredStates() const { return explored; }
+  /**
+   * @return maximal number of zones stored at once by the last call of
+   *         solve()
+   */
+  ::std::size_t numPeakZones() const { return peak_zones; }
+  /** @return number of layers the states are swept in */
+  ::std::size_t numLayers() const { return num_layers; }
+
+private:
+  /** Atomic constraint x_i - x_j <(=) c. */
+  struct zoneConstraint {
+    ::std::size_t i;
+    ::std::size_t j;
+    DBM::raw_t raw;
+  };
+  typedef ::std::vector<zoneConstraint> ZoneConstraints;
+
+  const Automaton *ta = nullptr;
+  ::std::size_t goal = AutomatonIndex::npos;
+  ::std::string unsupported;
+  ::std::size_t explored = 0;
+  ::std::size_t peak_zones = 0;
+  ::std::size_t num_layers = 1;
+  /** Layer of each state. */
+  ::std::vector<::std::size_t> layers;
+  /** Index of each clock in the zones, 0 is the reference clock. */
+  ::std::unordered_map<Symbol, ::std::size_t> clock_index;
+  ::std::vector<Symbol> clock_names;
+  ::std::size_t global_clock = 0;
+  ::std::vector<timepoint> max_constants;
+  ::std::vector<ZoneConstraints> invariants;
+  ::std::vector<ZoneConstraints> guards;
+  ::std::vector<::std::vector<::std::size_t>> resets;
+  /** Transitions that can fire, per source state. */
+  ::std::vector<::std::vector<::std::size_t>> outgoing;
+  /** Destination state of each transition. */
+  ::std::vector<::std::size_t> destinations;
+
+  /** Assigns each state to a layer by plan progress. */
+  void computeLayers();
+  /** @return lower bound of the global clock within a zone */
+  timepoint earliest(const DBM &zone) const;
+  /**
+   * Translates a constraint into zone constraints and updates the maximal
+   * constants of the clocks.
+   *
+   * @param cc constraint to translate
+   * @param res receives the zone constraints
+   * @return false iff \a cc cannot be handled
+   */
+  bool translate(const FlatCC &cc, ZoneConstraints &res);
+  /**
+   * Restricts a zone to the valuations satisfying constraints.
+   *
+   * @return false iff the zone became empty
+   */
+  static bool apply(DBM &zone, const ZoneConstraints &constraints);
+  /** @return zone of the initial state after delaying */
+  DBM initialZone(::std::size_t state) const;
+  /**
+   * Computes the successor zone of a zone by taking a transition and
+   * delaying afterwards.
+   *
+   * @param zone zone of the source state, receives the successor zone
+   * @param trans position of the transition
+   * @return false iff the transition cannot be taken
+   */
+  bool post(DBM &zone, ::std::size_t trans) const;
+  /**
+   * Converts a zone to the representation of UTAPTraceParser.
+   *
+   * @param zone zone to convert
+   * @return non-trivial bounds of \a zone by clock names
+   */
+  dbm_t toDbmT(const DBM &zone) const;
+  /**
+   * Builds the symbolic trace of a path without extrapolating the zones.
+   *
+   * @param initial initial state of the path
+   * @param path transitions of the path in order
+   * @param trace receives the trace
+   * @return false iff the path is not feasible (the extrapolation is not
+   *         exact on difference constraints)
+   */
+  bool buildTrace(::std::size_t initial,
+                  const ::std::vector<::std::size_t> &path,
+                  SymbolicTrace &trace) const;
+};
+} // end namespace taptenc
@@ -0,0 +1,125 @@
+/** \file
+ * Interned strings to cheaply store and compare identifiers.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "symbol_table.h"
+#include "timed-automata/state_id.h"
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace taptenc;
+
+namespace {
+/**
+ * Global storage of all interned strings.
+ *
+ * Entries are allocated individually, so their addresses stay stable while
+ * the table grows and shrinks. The empty string is interned first, so it is
+ * never released.
+ */
+struct symbolTable {
+  ::std::vector<::std::unique_ptr<Symbol::entry>> entries;
+  ::std::unordered_map<::std::string_view, const Symbol::entry *> lookup;
+  ::std::shared_mutex mutex;
+  /** Index of the next interned entry. */
+  ::std::uint32_t next_index = 0;
+  const Symbol::entry *add(const ::std::string &str) {
+    entries.push_back(::std::make_unique<Symbol::entry>(
+        str, ::std::hash<::std::string>{}(str), next_index++));
+    const Symbol::entry *res = entries.back().get();
+    lookup.emplace(::std::string_view(res->str), res);
+    return res;
+  }
+  symbolTable() { add(""); }
+};
+
+symbolTable &getTable() {
+  static symbolTable table;
+  return table;
+}
+} // end anonymous namespace
+
+const Symbol::entry *Symbol::intern(const std::string &str) {
+  symbolTable &table = getTable();
+  {
+    std::shared_lock<std::shared_mutex> read_lock(table.mutex);
+    auto search = table.lookup.find(std::string_view(str));
+    if (search != table.lookup.end()) {
+      return search->second;
+    }
+  }
+  std::unique_lock<std::shared_mutex> write_lock(table.mutex);
+  // another thread may have added the string in the meantime
+  auto search = table.lookup.find(std::string_view(str));
+  if (search != table.lookup.end()) {
+    return search->second;
+  }
+  return table.add(str);
+}
+
+Symbol::Symbol() {
+  static const entry *empty_entry = intern("");
+  e = empty_entry;
+}
+
+Symbol::Symbol(const std::string &str) : e(intern(str)) {}
+
+Symbol::Symbol(const char *str) : e(intern(std::string(str))) {}
+
+std::size_t Symbol::tableSize() {
+  symbolTable &table = getTable();
+  std::shared_lock<std::shared_mutex> read_lock(table.mutex);
+  return table.entries.size();
+}
+
+Symbol::Checkpoint Symbol::checkpoint() {
+  symbolTable &table = getTable();
+  std::shared_lock<std::shared_mutex> read_lock(table.mutex);
+  return table.entries.size();
+}
+
+void Symbol::release(Checkpoint cp) {
+  symbolTable &table = getTable();
+  std::unique_lock<std::shared_mutex> write_lock(table.mutex);
+  if (cp >= table.entries.size()) {
+    return;
+  }
+  // entries are stored in the order of interning, so exactly the entries
+  // from the checkpoint on have an index of at least first_index
+  std::uint32_t first_index = table.entries[cp]->index;
+  auto released = [first_index](const Symbol &sym) {
+    return sym.e->index >= first_index &&
+           !sym.e->pinned.load(std::memory_order_relaxed);
+  };
+  // drop all decompositions that refer to released symbols (before they are
+  // freed), this includes older ids that were first decomposed after the
+  // checkpoint, affected entries recompute them on demand
+  for (std::size_t i = 0; i < table.entries.size(); i++) {
+    const entry &curr = *table.entries[i];
+    const stateId *structured = curr.structured.load(std::memory_order_relaxed);
+    if (structured != nullptr &&
+        (i >= cp || released(structured->plan_action) ||
+         released(structured->timeline) || released(structured->window) ||
+         released(structured->base))) {
+      curr.structured.store(nullptr, std::memory_order_relaxed);
+      delete structured;
+    }
+  }
+  std::size_t kept = cp;
+  for (std::size_t i = cp; i < table.entries.size(); i++) {
+    std::unique_ptr<entry> &curr = table.entries[i];
+    if (curr->pinned.load(std::memory_order_relaxed)) {
+      table.entries[kept++] = std::move(curr);
+    } else {
+      table.lookup.erase(std::string_view(curr->str));
+      curr.reset();
+    }
+  }
+  table.entries.resize(kept);
+}
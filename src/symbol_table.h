@@ -0,0 +1,180 @@
+/** \file
+ * Interned strings to cheaply store and compare identifiers.
+ *
+ * State, transition and clock ids are long strings composed of separators
+ * (see constants.h) that are copied and compared over and over during the
+ * encoding. Interning them once makes copies and equality checks constant
+ * time, the underlying string is only needed again for printing and parsing.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace taptenc {
+struct stateId;
+
+/**
+ * Handle to a string stored in the global symbol table.
+ *
+ * Symbols with equal content share the same table entry, hence equality and
+ * hashing do not need to look at the characters.
+ *
+ * Entries are kept until they are explicitly released (see release()), so
+ * handles stay valid for the whole program run unless the program releases
+ * the symbols it created for a plan once the plan is done. Programs that
+ * transform many plans should do so, as the table grows with every plan
+ * otherwise.
+ *
+ * The symbol table is thread safe, except for release().
+ */
+class Symbol {
+public:
+  /** Content of one table entry. */
+  struct entry {
+    ::std::string str;
+    ::std::size_t hash;
+    /** Position of the entry in the order of interning. */
+    ::std::uint32_t index;
+    /**
+     * Lazily computed decomposition of the string into the parts of a state
+     * id, see StateId::of().
+     */
+    mutable ::std::atomic<const struct stateId *> structured;
+    /** True if the entry survives release(), see pin(). */
+    mutable ::std::atomic<bool> pinned;
+    entry(const ::std::string &arg_str, ::std::size_t arg_hash,
+          ::std::uint32_t arg_index)
+        : str(arg_str), hash(arg_hash), index(arg_index), structured(nullptr),
+          pinned(false) {}
+  };
+  /** Position in the symbol table, see checkpoint(). */
+  typedef ::std::size_t Checkpoint;
+
+  /** Creates the symbol of the empty string. */
+  Symbol();
+  /**
+   * Interns a string.
+   *
+   * @param str string to intern
+   */
+  Symbol(const ::std::string &str);
+  /**
+   * Interns a string.
+   *
+   * @param str null terminated string to intern
+   */
+  Symbol(const char *str);
+
+  /** @return interned string */
+  const ::std::string &str() const { return e->str; }
+  operator const ::std::string &() const { return e->str; }
+  /** @return hash of the interned string, computed once during interning */
+  ::std::size_t hash() const { return e->hash; }
+  /** @return unique index of the symbol */
+  ::std::uint32_t index() const { return e->index; }
+  /** @return table entry of the symbol */
+  const entry &getEntry() const { return *e; }
+  bool empty() const { return e->str.empty(); }
+  ::std::size_t size() const { return e->str.size(); }
+
+  /** Equality by handle, no string comparison involved. */
+  bool operator==(const Symbol &r) const { return e == r.e; }
+  bool operator!=(const Symbol &r) const { return e != r.e; }
+  /** Lexicographic ordering of the underlying strings. */
+  bool operator<(const Symbol &r) const {
+    return e != r.e && e->str < r.e->str;
+  }
+
+  /**
+   * Keeps the symbol in the table when symbols are released.
+   *
+   * Meant for symbols that are referenced by global registries (such as the
+   * clock registry of ClockSet).
+   */
+  void pin() const { e->pinned.store(true, ::std::memory_order_relaxed); }
+
+  /** @return number of symbols currently stored in the table */
+  static ::std::size_t tableSize();
+  /**
+   * Marks the current end of the symbol table.
+   *
+   * @return checkpoint to release all symbols interned afterwards
+   */
+  static Checkpoint checkpoint();
+  /**
+   * Releases all symbols interned after a checkpoint (except pinned ones).
+   *
+   * Cached state id decompositions (see StateId::of()) of released symbols
+   * and all decompositions that refer to released symbols are dropped, so
+   * remaining symbols compute them again when they are queried next.
+   *
+   * Handles to released symbols (and StateId references obtained from them)
+   * become dangling, hence this may only be called when all objects created
+   * after taking the checkpoint are destroyed and no other thread uses
+   * symbols. Checkpoints taken after \a cp become invalid.
+   *
+   * @param cp checkpoint obtained by checkpoint()
+   */
+  static void release(Checkpoint cp);
+
+private:
+  const entry *e;
+  static const entry *intern(const ::std::string &str);
+};
+
+/**
+ * @name Operators to mix symbols with plain strings
+ */
+///@{
+inline bool operator==(const Symbol &l, const ::std::string &r) {
+  return l.str() == r;
+}
+inline bool operator==(const ::std::string &l, const Symbol &r) {
+  return l == r.str();
+}
+inline bool operator==(const Symbol &l, const char *r) { return l.str() == r; }
+inline bool operator!=(const Symbol &l, const ::std::string &r) {
+  return l.str() != r;
+}
+inline bool operator!=(const ::std::string &l, const Symbol &r) {
+  return l != r.str();
+}
+inline bool operator!=(const Symbol &l, const char *r) { return l.str() != r; }
+inline ::std::string operator+(const Symbol &l, const Symbol &r) {
+  return l.str() + r.str();
+}
+inline ::std::string operator+(const Symbol &l, const ::std::string &r) {
+  return l.str() + r;
+}
+inline ::std::string operator+(const ::std::string &l, const Symbol &r) {
+  return l + r.str();
+}
+inline ::std::string operator+(const Symbol &l, const char *r) {
+  return l.str() + r;
+}
+inline ::std::string operator+(const char *l, const Symbol &r) {
+  return l + r.str();
+}
+inline ::std::string operator+(const Symbol &l, char r) { return l.str() + r; }
+inline ::std::string operator+(char l, const Symbol &r) { return l + r.str(); }
+inline ::std::ostream &operator<<(::std::ostream &os, const Symbol &s) {
+  return os << s.str();
+}
+///@}
+} // end namespace taptenc
+
+namespace std {
+template <> struct hash<::taptenc::Symbol> {
+  size_t operator()(const ::taptenc::Symbol &s) const noexcept {
+    return s.hash();
+  }
+};
+} // end namespace std
@@ -0,0 +1,49 @@
+/** \file
+ * Fixed size pool of worker threads.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "thread_pool.h"
+
+#include <algorithm>
+
+using namespace taptenc;
+
+ThreadPool::ThreadPool(std::size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers.reserve(num_threads);
+  for (std::size_t i = 0; i < num_threads; i++) {
+    workers.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cond.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void ThreadPool::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        // only reached when stopping and all tasks are done
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    task();
+  }
+}
@@ -0,0 +1,73 @@
+/** \file
+ * Fixed size pool of worker threads.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace taptenc {
+/**
+ * Runs submitted tasks on a fixed number of worker threads.
+ *
+ * Tasks are started in the order of submission. Destroying the pool waits
+ * until all submitted tasks are done.
+ */
+class ThreadPool {
+public:
+  /**
+   * Starts the worker threads.
+   *
+   * @param num_threads number of workers, 0 selects the number of hardware
+   *                    threads
+   */
+  explicit ThreadPool(::std::size_t num_threads = 0);
+  /** Finishes all submitted tasks and joins the workers. */
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * Schedules a task.
+   *
+   * @param task callable without arguments
+   * @return future holding the result (or exception) of \a task
+   */
+  template <class F>
+  ::std::future<::std::invoke_result_t<F>> submit(F &&task) {
+    typedef ::std::invoke_result_t<F> result_t;
+    auto packaged = ::std::make_shared<::std::packaged_task<result_t()>>(
+        ::std::forward<F>(task));
+    ::std::future<result_t> res = packaged->get_future();
+    {
+      ::std::lock_guard<::std::mutex> lock(mutex);
+      tasks.push([packaged]() { (*packaged)(); });
+    }
+    cond.notify_one();
+    return res;
+  }
+
+  /** @return number of worker threads */
+  ::std::size_t size() const { return workers.size(); }
+
+private:
+  ::std::vector<::std::thread> workers;
+  ::std::queue<::std::function<void()>> tasks;
+  ::std::mutex mutex;
+  ::std::condition_variable cond;
+  bool stopping = false;
+
+  void work();
+};
+} // end namespace taptenc
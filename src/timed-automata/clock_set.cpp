@@ -0,0 +1,215 @@
+/** \file
+ * Sets of clocks stored as bitsets over a global clock registry.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "clock_set.h"
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+using namespace taptenc;
+
+namespace {
+constexpr std::size_t CHUNK_SIZE = 256;
+constexpr std::size_t MAX_CHUNKS = 4096;
+
+/**
+ * Global registry of all clocks.
+ *
+ * Clocks are stored in chunks of fixed size that are never moved, hence
+ * registered clocks can be accessed by index without locking (iterating over
+ * clock sets does this a lot). Registering new clocks requires the lock.
+ */
+struct clockRegistry {
+  ::std::array<::std::atomic<::std::shared_ptr<Clock> *>, MAX_CHUNKS> chunks;
+  ::std::size_t num_clocks = 0;
+  ::std::unordered_map<Symbol, ::std::size_t> lookup;
+  ::std::shared_mutex mutex;
+  clockRegistry() {
+    for (auto &chunk : chunks) {
+      chunk.store(nullptr, ::std::memory_order_relaxed);
+    }
+  }
+  ~clockRegistry() {
+    for (auto &chunk : chunks) {
+      delete[] chunk.load(::std::memory_order_relaxed);
+    }
+  }
+};
+
+clockRegistry &getRegistry() {
+  static clockRegistry registry;
+  return registry;
+}
+
+constexpr std::size_t NOT_REGISTERED = std::numeric_limits<std::size_t>::max();
+} // end anonymous namespace
+
+std::size_t clockSet::lookupIndex(const Symbol &id) {
+  clockRegistry &registry = getRegistry();
+  std::shared_lock<std::shared_mutex> read_lock(registry.mutex);
+  auto search = registry.lookup.find(id);
+  if (search != registry.lookup.end()) {
+    return search->second;
+  }
+  return NOT_REGISTERED;
+}
+
+std::size_t clockSet::indexOf(const std::shared_ptr<Clock> &clock) {
+  std::size_t res = lookupIndex(clock->id);
+  if (res != NOT_REGISTERED) {
+    return res;
+  }
+  clockRegistry &registry = getRegistry();
+  std::unique_lock<std::shared_mutex> write_lock(registry.mutex);
+  // another thread may have registered the clock in the meantime
+  auto emplaced = registry.lookup.emplace(clock->id, registry.num_clocks);
+  if (emplaced.second) {
+    // the registry outlives plans, so the clock id must not be released
+    clock->id.pin();
+    std::size_t chunk_pos = registry.num_clocks / CHUNK_SIZE;
+    if (chunk_pos >= MAX_CHUNKS) {
+      std::cout << "ClockSet indexOf: too many clocks registered" << std::endl;
+      std::abort();
+    }
+    std::shared_ptr<Clock> *chunk =
+        registry.chunks[chunk_pos].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+      chunk = new std::shared_ptr<Clock>[CHUNK_SIZE];
+      registry.chunks[chunk_pos].store(chunk, std::memory_order_release);
+    }
+    chunk[registry.num_clocks % CHUNK_SIZE] = clock;
+    registry.num_clocks++;
+  }
+  return emplaced.first->second;
+}
+
+const std::shared_ptr<Clock> &clockSet::clockAt(std::size_t index) {
+  // indices are only handed out after the clock is stored, see indexOf()
+  return getRegistry()
+      .chunks[index / CHUNK_SIZE]
+      .load(std::memory_order_acquire)[index % CHUNK_SIZE];
+}
+
+const std::shared_ptr<Clock> &clockSet::clockOf(const Symbol &id) {
+  std::size_t index = lookupIndex(id);
+  if (index == NOT_REGISTERED) {
+    index = indexOf(std::make_shared<Clock>(id));
+  }
+  return clockAt(index);
+}
+
+std::size_t clockSet::registrySize() {
+  clockRegistry &registry = getRegistry();
+  std::shared_lock<std::shared_mutex> read_lock(registry.mutex);
+  return registry.num_clocks;
+}
+
+clockSet::clockSet(std::initializer_list<std::shared_ptr<Clock>> clocks) {
+  insert(clocks);
+}
+
+void clockSet::set(std::size_t index) {
+  if (index / 64 >= words.size()) {
+    words.resize(index / 64 + 1, 0);
+  }
+  words[index / 64] |= std::uint64_t(1) << (index % 64);
+}
+
+bool clockSet::test(std::size_t index) const {
+  return index != NOT_REGISTERED && index / 64 < words.size() &&
+         (words[index / 64] >> (index % 64)) & 1;
+}
+
+std::size_t clockSet::nextIndex(std::size_t from) const {
+  std::size_t word_pos = from / 64;
+  if (word_pos >= words.size()) {
+    return endIndex();
+  }
+  std::uint64_t curr = words[word_pos] & (~std::uint64_t(0) << (from % 64));
+  while (curr == 0) {
+    word_pos++;
+    if (word_pos == words.size()) {
+      return endIndex();
+    }
+    curr = words[word_pos];
+  }
+  return word_pos * 64 + __builtin_ctzll(curr);
+}
+
+bool clockSet::insert(const std::shared_ptr<Clock> &clock) {
+  std::size_t index = indexOf(clock);
+  if (test(index)) {
+    return false;
+  }
+  set(index);
+  return true;
+}
+
+void clockSet::insert(std::initializer_list<std::shared_ptr<Clock>> clocks) {
+  for (const auto &cl : clocks) {
+    insert(cl);
+  }
+}
+
+void clockSet::insert(const clockSet &other) {
+  if (other.words.size() > words.size()) {
+    words.resize(other.words.size(), 0);
+  }
+  for (std::size_t i = 0; i < other.words.size(); i++) {
+    words[i] |= other.words[i];
+  }
+}
+
+clockSet &clockSet::operator|=(const clockSet &other) {
+  insert(other);
+  return *this;
+}
+
+clockSet::const_iterator clockSet::find(const Symbol &id) const {
+  std::size_t index = lookupIndex(id);
+  if (test(index)) {
+    return const_iterator(this, index);
+  }
+  return end();
+}
+
+bool clockSet::contains(const Symbol &id) const {
+  return test(lookupIndex(id));
+}
+
+bool clockSet::contains(const std::shared_ptr<Clock> &clock) const {
+  return contains(clock->id);
+}
+
+std::size_t clockSet::size() const {
+  std::size_t res = 0;
+  for (const auto &word : words) {
+    res += __builtin_popcountll(word);
+  }
+  return res;
+}
+
+bool clockSet::operator<(const clockSet &r) const {
+  if (words.size() != r.words.size()) {
+    return words.size() < r.words.size();
+  }
+  return words < r.words;
+}
+
+std::size_t clockSet::hash() const {
+  std::size_t res = words.size();
+  for (const auto &word : words) {
+    res ^= std::hash<std::uint64_t>{}(word) + 0x9e3779b9 + (res << 6) +
+           (res >> 2);
+  }
+  return res;
+}
@@ -0,0 +1,146 @@
+/** \file
+ * Sets of clocks stored as bitsets over a global clock registry.
+ *
+ * Every clock id is registered once and receives a dense index, a set of
+ * clocks then is a bitset over these indices. Unions, membership tests and
+ * comparisons are word operations and copying a set does not allocate nodes.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include "../constraints/constraints.h"
+#include "../symbol_table.h"
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace taptenc {
+/**
+ * Set of clocks represented as bitset over the indices of the clock registry.
+ *
+ * Clocks are identified by their id, inserting a clock that has the same id
+ * as an already registered one refers to the registered clock object.
+ * Iteration yields the registered clock objects in order of registration.
+ *
+ * The clock registry is thread safe, individual sets are not.
+ */
+class clockSet {
+public:
+  /** Forward iterator over the clocks contained in a set. */
+  class const_iterator {
+  public:
+    typedef ::std::forward_iterator_tag iterator_category;
+    typedef ::std::shared_ptr<Clock> value_type;
+    typedef ::std::ptrdiff_t difference_type;
+    typedef const ::std::shared_ptr<Clock> *pointer;
+    typedef const ::std::shared_ptr<Clock> &reference;
+
+    const_iterator() : set(nullptr), pos(0) {}
+    const_iterator(const clockSet *arg_set, ::std::size_t arg_pos)
+        : set(arg_set), pos(arg_pos) {}
+    reference operator*() const { return clockSet::clockAt(pos); }
+    pointer operator->() const { return &clockSet::clockAt(pos); }
+    const_iterator &operator++() {
+      pos = set->nextIndex(pos + 1);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator res(*this);
+      ++(*this);
+      return res;
+    }
+    bool operator==(const const_iterator &r) const { return pos == r.pos; }
+    bool operator!=(const const_iterator &r) const { return pos != r.pos; }
+
+  private:
+    const clockSet *set;
+    ::std::size_t pos;
+  };
+  typedef const_iterator iterator;
+
+  clockSet() = default;
+  clockSet(::std::initializer_list<::std::shared_ptr<Clock>> clocks);
+  template <class InputIt> clockSet(InputIt first, InputIt last) {
+    insert(first, last);
+  }
+
+  /**
+   * Adds a clock to the set.
+   *
+   * @param clock clock to add, registered if its id is not known yet
+   * @return true iff the clock was not contained before
+   */
+  bool insert(const ::std::shared_ptr<Clock> &clock);
+  void insert(::std::initializer_list<::std::shared_ptr<Clock>> clocks);
+  template <class InputIt> void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+  /**
+   * Adds all clocks of another set (set union).
+   *
+   * @param other set of clocks to add
+   */
+  void insert(const clockSet &other);
+  clockSet &operator|=(const clockSet &other);
+
+  /**
+   * Looks up a clock by its id.
+   *
+   * @param id id of the clock
+   * @return iterator to the clock or end() if it is not contained
+   */
+  const_iterator find(const Symbol &id) const;
+  bool contains(const Symbol &id) const;
+  bool contains(const ::std::shared_ptr<Clock> &clock) const;
+
+  ::std::size_t size() const;
+  bool empty() const { return words.empty(); }
+  void clear() { words.clear(); }
+  const_iterator begin() const { return const_iterator(this, nextIndex(0)); }
+  const_iterator end() const { return const_iterator(this, endIndex()); }
+
+  bool operator==(const clockSet &r) const { return words == r.words; }
+  bool operator!=(const clockSet &r) const { return words != r.words; }
+  /** Ordering by the underlying bits, only meant for sorting. */
+  bool operator<(const clockSet &r) const;
+  ::std::size_t hash() const;
+
+  /**
+   * Obtains the registered clock with the given id.
+   *
+   * @param id id of the clock, registered if it is not known yet
+   * @return registered clock object
+   */
+  static const ::std::shared_ptr<Clock> &clockOf(const Symbol &id);
+  /** @return number of clocks registered so far */
+  static ::std::size_t registrySize();
+
+private:
+  /** Bits of the set, trailing words are never zero. */
+  ::std::vector<::std::uint64_t> words;
+
+  ::std::size_t nextIndex(::std::size_t from) const;
+  ::std::size_t endIndex() const { return words.size() * 64; }
+  void set(::std::size_t index);
+  bool test(::std::size_t index) const;
+  static ::std::size_t indexOf(const ::std::shared_ptr<Clock> &clock);
+  static ::std::size_t lookupIndex(const Symbol &id);
+  static const ::std::shared_ptr<Clock> &clockAt(::std::size_t index);
+};
+typedef class clockSet ClockSet;
+} // end namespace taptenc
+
+namespace std {
+template <> struct hash<::taptenc::ClockSet> {
+  size_t operator()(const ::taptenc::ClockSet &s) const noexcept {
+    return s.hash();
+  }
+};
+} // end namespace std
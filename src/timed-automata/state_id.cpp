@@ -0,0 +1,58 @@
+/** \file
+ * Structured access to the parts of a state id.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#include "state_id.h"
+#include "../constants.h"
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+using namespace taptenc;
+
+stateId::stateId(const std::string &id) {
+  size_t first_tl = id.find_first_of(constants::TL_SEP);
+  size_t last_tl = id.find_last_of(constants::TL_SEP);
+  size_t first_base = id.find_first_of(constants::BASE_SEP);
+  size_t last_base = id.find_last_of(constants::BASE_SEP);
+  std::string pa_str =
+      (first_tl == std::string::npos) ? id : id.substr(0, first_tl);
+  plan_action = Symbol(pa_str);
+  timeline = Symbol((first_base == std::string::npos)
+                        ? id
+                        : id.substr(0, first_base));
+  std::string after_tl =
+      (last_tl == std::string::npos) ? id : id.substr(last_tl + 1);
+  window =
+      Symbol(after_tl.substr(0, after_tl.find_first_of(constants::BASE_SEP)));
+  std::string base_str =
+      (last_base == std::string::npos) ? id : id.substr(last_base + 1);
+  base = Symbol(base_str);
+  num_components = 1 + std::count(base_str.begin(), base_str.end(),
+                                  constants::COMPONENT_SEP);
+  pa_index = -1;
+  size_t pa_sep = pa_str.find_last_of(constants::PA_SEP);
+  if (pa_sep != std::string::npos && pa_sep + 1 < pa_str.size() &&
+      std::all_of(pa_str.begin() + pa_sep + 1, pa_str.end(),
+                  [](unsigned char c) { return std::isdigit(c); })) {
+    pa_index = std::stoi(pa_str.substr(pa_sep + 1));
+  }
+}
+
+const stateId &stateId::of(const Symbol &id) {
+  const stateId *res =
+      id.getEntry().structured.load(std::memory_order_acquire);
+  if (res == nullptr) {
+    const stateId *parsed = new stateId(id.str());
+    if (id.getEntry().structured.compare_exchange_strong(
+            res, parsed, std::memory_order_acq_rel)) {
+      res = parsed;
+    } else {
+      // another thread was faster, res now holds its result
+      delete parsed;
+    }
+  }
+  return *res;
+}
@@ -0,0 +1,63 @@
+/** \file
+ * Structured access to the parts of a state id.
+ *
+ * \author (2019) Tarik Viehmann
+ */
+
+#pragma once
+
+#include "../symbol_table.h"
+#include <cstddef>
+
+namespace taptenc {
+/**
+ * Decomposition of a state id created during the encoding.
+ *
+ * State ids of the direct encoding are composed as
+ * ~~~
+ * pa TL_SEP op CONSTRAINT_SEP sub ... BASE_SEP base
+ * ~~~
+ * where pa is a plan action (which itself ends with PA_SEP and the index of
+ * the plan action) and base consists of the base state ids of the platform
+ * components, separated by COMPONENT_SEP.
+ *
+ * The parts are computed once per interned id and cached in the symbol table,
+ * so querying them is as cheap as a pointer lookup.
+ */
+struct stateId {
+  /** Plan action part, prefix before the first TL_SEP (or the whole id). */
+  Symbol plan_action;
+  /**
+   * Timeline part (plan action and window path), prefix before the first
+   * BASE_SEP (or the whole id).
+   */
+  Symbol timeline;
+  /**
+   * Window path, the part after the last TL_SEP and before the first
+   * BASE_SEP (or the whole id).
+   */
+  Symbol window;
+  /** Base part, suffix after the last BASE_SEP (or the whole id). */
+  Symbol base;
+  /** Index encoded after PA_SEP in \a plan_action or -1 if there is none. */
+  int pa_index;
+  /** Number of platform components the base part is composed of. */
+  ::std::size_t num_components;
+
+  /**
+   * Obtains the structured view of an id.
+   *
+   * The decomposition is cached with \a id until \a id or one of its parts
+   * is released, hence it may refer to symbols interned after \a id.
+   *
+   * @param id state id to decompose
+   * @return decomposition of \a id, valid until \a id or one of its parts
+   *         is released (see Symbol::release())
+   */
+  static const stateId &of(const Symbol &id);
+
+private:
+  stateId(const ::std::string &id);
+};
+typedef struct stateId StateId;
+} // end namespace taptenc
@@ -9,119 +9,35 @@
 #include "../constants.h"
 #include "../constraints/constraints.h"
 #include "../utils.h"
+#include "state_id.h"
 
 #include <algorithm>
 #include <iostream>
+#include <utility>
 
 using namespace taptenc;
 
-/**
- * Helpers to help implementing move constructors.
- */
-namespace moveutils {
-/**
- * Swaps the members of two states using std::swap().
- *
- * @param first first state participating in the swap
- * @param second second state participating in the swap
- */
-void swap(state &first, state &second) {
-  std::swap(first.id, second.id);
-  std::swap(first.inv, second.inv);
-  std::swap(first.urgent, second.urgent);
-  std::swap(first.initial, second.initial);
-}
-
-/**
- * Swaps the members of two transitions using std::swap().
- *
- * @param first first transition participating in the swap
- * @param second second transition participating in the swap
- */
-void swap(transition &first, transition &second) {
-  std::swap(first.source_id, second.source_id);
-  std::swap(first.dest_id, second.dest_id);
-  std::swap(first.action, second.action);
-  std::swap(first.guard, second.guard);
-  std::swap(first.update, second.update);
-  std::swap(first.sync, second.sync);
-  std::swap(first.passive, second.passive);
-}
-} // end namespace moveutils
-
-using namespace moveutils;
-
-state::state(::std::string arg_id, const ClockConstraint &arg_inv,
-             bool arg_urgent, bool arg_initial)
-    : id(arg_id), urgent(arg_urgent), initial(arg_initial) {
-  inv = arg_inv.createCopy();
-}
-
-state::state(const state &other) {
-  id = other.id;
-  inv = other.inv->createCopy();
-  urgent = other.urgent;
-  initial = other.initial;
-}
-state::state(state &&other) noexcept {
-  id = std::move(other.id);
-  inv = other.inv->createCopy();
-  urgent = std::move(other.urgent);
-  initial = std::move(other.initial);
-}
-
-state &state::operator=(const state &other) {
-  *this = state(other);
-  return *this;
-}
-
-state &state::operator=(state &&other) noexcept {
-  swap(*this, other);
-  return *this;
-}
-
-transition::transition(const transition &other) {
-  source_id = other.source_id;
-  dest_id = other.dest_id;
-  action = other.action;
-  guard = other.guard->createCopy();
-  update = other.update;
-  sync = other.sync;
-  passive = other.passive;
-}
-
-transition::transition(transition &&other) noexcept {
-  source_id = std::move(other.source_id);
-  dest_id = std::move(other.dest_id);
-  action = std::move(other.action);
-  guard = std::move(other.guard);
-  update = std::move(other.update);
-  sync = std::move(other.sync);
-  passive = std::move(other.passive);
-}
-
-transition &transition::operator=(const transition &other) {
-  *this = transition(other);
-  return *this;
-}
-
-transition &transition::operator=(transition &&other) noexcept {
-  swap(*this, other);
-  return *this;
-}
+state::state(Symbol arg_id, const ClockConstraint &arg_inv, bool arg_urgent,
+             bool arg_initial)
+    : id(arg_id), inv(FlatCC::of(arg_inv)), urgent(arg_urgent),
+      initial(arg_initial) {}
 
 bool state::operator<(const state &r) const {
-  return id + inv->toString() < r.id + r.inv->toString();
+  if (id != r.id) {
+    return id < r.id;
+  }
+  return inv->index < r.inv->index;
 }
 
-transition::transition(::std::string arg_source_id, ::std::string arg_dest_id,
+std::size_t state::hash() const { return id.hash() * 31 + inv->hash; }
+
+transition::transition(Symbol arg_source_id, Symbol arg_dest_id,
                        std::string arg_action, const ClockConstraint &arg_guard,
                        const update_t &arg_update, ::std::string arg_sync,
                        bool arg_passive)
     : source_id(arg_source_id), dest_id(arg_dest_id), action(arg_action),
-      update(arg_update), sync(arg_sync), passive(arg_passive) {
-  guard = arg_guard.createCopy();
-}
+      guard(FlatCC::of(arg_guard)), update(arg_update), sync(arg_sync),
+      passive(arg_passive) {}
 
 ::std::string transition::updateToString() const {
   std::string res;
@@ -144,10 +60,7 @@ update_t transition::updateFromString(const ::std::string &update,
   size_t next_assignment_pos = update_str.find("=");
   while (next_assignment_pos != std::string::npos) {
     std::string curr_clock = trim(update_str.substr(0, next_assignment_pos));
-    auto clock_ptr_it = std::find_if(clocks.begin(), clocks.end(),
-                                     [curr_clock](const auto &clock_ptr) {
-                                       return clock_ptr.get()->id == curr_clock;
-                                     });
+    auto clock_ptr_it = clocks.find(Symbol(curr_clock));
     if (clock_ptr_it != clocks.end()) {
       res.insert(*clock_ptr_it);
     } else {
@@ -162,9 +75,28 @@ update_t transition::updateFromString(const ::std::string &update,
 }
 
 bool transition::operator<(const transition &r) const {
-  return source_id + dest_id + guard->toString() + updateToString() + sync <
-         r.source_id + r.dest_id + r.guard->toString() + r.updateToString() +
-             r.sync;
+  if (source_id != r.source_id) {
+    return source_id < r.source_id;
+  }
+  if (dest_id != r.dest_id) {
+    return dest_id < r.dest_id;
+  }
+  if (guard != r.guard) {
+    return guard->index < r.guard->index;
+  }
+  if (update != r.update) {
+    return update < r.update;
+  }
+  return sync < r.sync;
+}
+
+std::size_t transition::hash() const {
+  std::size_t res = source_id.hash();
+  res = res * 31 + dest_id.hash();
+  res = res * 31 + guard->hash;
+  res = res * 31 + update.hash();
+  res = res * 31 + std::hash<std::string>{}(sync);
+  return res;
 }
 
 automaton::automaton(::std::vector<State> arg_states,
@@ -182,5 +114,217 @@ automaton::automaton(::std::vector<State> arg_states,
   prefix = arg_prefix;
 }
 
-tlEntry::tlEntry(Automaton &arg_ta, ::std::vector<Transition> arg_trans_out)
-    : ta(arg_ta), trans_out(arg_trans_out) {}
+automatonIndex::automatonIndex(const automaton &ta)
+    : out_offsets(ta.states.size() + 1, 0), in_offsets(ta.states.size() + 1, 0) {
+  state_pos.reserve(ta.states.size());
+  for (size_t i = 0; i < ta.states.size(); i++) {
+    // the first state with a given id is the one that is found
+    state_pos.emplace(ta.states[i].id, i);
+  }
+  std::vector<std::pair<size_t, size_t>> endpoints;
+  endpoints.reserve(ta.transitions.size());
+  for (const auto &trans : ta.transitions) {
+    endpoints.push_back(
+        std::make_pair(stateIndex(trans.source_id), stateIndex(trans.dest_id)));
+    if (endpoints.back().first != npos && endpoints.back().second != npos) {
+      out_offsets[endpoints.back().first + 1]++;
+      in_offsets[endpoints.back().second + 1]++;
+    }
+  }
+  for (size_t i = 1; i < out_offsets.size(); i++) {
+    out_offsets[i] += out_offsets[i - 1];
+    in_offsets[i] += in_offsets[i - 1];
+  }
+  out_trans.resize(out_offsets.back());
+  in_trans.resize(in_offsets.back());
+  std::vector<size_t> out_fill(out_offsets.begin(), out_offsets.end() - 1);
+  std::vector<size_t> in_fill(in_offsets.begin(), in_offsets.end() - 1);
+  for (size_t i = 0; i < endpoints.size(); i++) {
+    if (endpoints[i].first != npos && endpoints[i].second != npos) {
+      out_trans[out_fill[endpoints[i].first]++] = i;
+      in_trans[in_fill[endpoints[i].second]++] = i;
+    }
+  }
+}
+
+size_t automatonIndex::stateIndex(const Symbol &id) const {
+  auto search = state_pos.find(id);
+  if (search == state_pos.end()) {
+    return npos;
+  }
+  return search->second;
+}
+
+automatonIndex::range automatonIndex::outgoing(size_t state) const {
+  return range{out_trans.data() + out_offsets[state],
+               out_trans.data() + out_offsets[state + 1]};
+}
+
+automatonIndex::range automatonIndex::incoming(size_t state) const {
+  return range{in_trans.data() + in_offsets[state],
+               in_trans.data() + in_offsets[state + 1]};
+}
+
+automatonIndex::range automatonIndex::outgoing(const Symbol &id) const {
+  size_t state = stateIndex(id);
+  if (state == npos) {
+    return range{nullptr, nullptr};
+  }
+  return outgoing(state);
+}
+
+automatonIndex::range automatonIndex::incoming(const Symbol &id) const {
+  size_t state = stateIndex(id);
+  if (state == npos) {
+    return range{nullptr, nullptr};
+  }
+  return incoming(state);
+}
+
+sharedAutomaton::sharedAutomaton(Automaton arg_ta)
+    : ta(std::move(arg_ta)), index(ta) {
+  bases.reserve(ta.states.size());
+  for (size_t i = 0; i < ta.states.size(); i++) {
+    bases.push_back(StateId::of(ta.states[i].id).base);
+    base_pos.emplace(bases.back(), i);
+  }
+  endpoints.reserve(ta.transitions.size());
+  for (const auto &trans : ta.transitions) {
+    endpoints.push_back(std::make_pair(index.stateIndex(trans.source_id),
+                                       index.stateIndex(trans.dest_id)));
+  }
+}
+
+tlEntry::tlEntry(const Automaton &arg_ta,
+                 ::std::vector<Transition> arg_trans_out)
+    : trans_out(std::move(arg_trans_out)), clocks(arg_ta.clocks),
+      base(std::make_shared<const SharedAutomaton>(arg_ta)),
+      prefix(arg_ta.prefix), renamed(false),
+      active(arg_ta.states.size(), true), extra_inv(nullptr),
+      keep_initial(true) {}
+
+tlEntry::tlEntry(::std::shared_ptr<const SharedAutomaton> arg_base,
+                 Symbol arg_prefix, ::std::vector<Transition> arg_trans_out)
+    : trans_out(std::move(arg_trans_out)), clocks(arg_base->ta.clocks),
+      base(std::move(arg_base)), prefix(arg_prefix), renamed(true),
+      active(base->ta.states.size(), true), extra_inv(nullptr),
+      keep_initial(true) {}
+
+tlEntry tlEntry::rename(Symbol new_prefix) const {
+  tlEntry res(*this);
+  res.trans_out.clear();
+  res.prefix = new_prefix;
+  res.renamed = true;
+  return res;
+}
+
+Symbol tlEntry::stateId(size_t pos) const {
+  if (renamed) {
+    return prefix + base->bases[pos];
+  }
+  return base->ta.states[pos].id;
+}
+
+bool tlEntry::containsState(const Symbol &id) const {
+  if (!renamed) {
+    size_t pos = base->index.stateIndex(id);
+    return pos != AutomatonIndex::npos && active[pos];
+  }
+  if (id.size() <= prefix.size() ||
+      id.str().compare(0, prefix.size(), prefix.str()) != 0) {
+    return false;
+  }
+  return containsBase(Symbol(id.str().substr(prefix.size())));
+}
+
+bool tlEntry::containsBase(const Symbol &base_id) const {
+  auto positions = base->base_pos.equal_range(base_id);
+  return std::any_of(positions.first, positions.second,
+                     [this](const auto &pos) { return active[pos.second]; });
+}
+
+void tlEntry::addInvariant(const ClockConstraint &inv) {
+  extra_inv = extra_inv ? FlatCC::conjunction(*extra_inv, inv)
+                        : FlatCC::of(inv);
+}
+
+bool tlEntry::keepsTransition(size_t pos) const {
+  const auto &ends = base->endpoints[pos];
+  if (ends.first == AutomatonIndex::npos ||
+      ends.second == AutomatonIndex::npos) {
+    // renamed copies only keep transitions between their states
+    return !renamed;
+  }
+  return active[ends.first] && active[ends.second];
+}
+
+size_t tlEntry::numStates() const {
+  return std::count(active.begin(), active.end(), true);
+}
+
+size_t tlEntry::numTransitions() const {
+  size_t res = 0;
+  for (size_t i = 0; i < base->ta.transitions.size(); i++) {
+    if (keepsTransition(i)) {
+      res++;
+    }
+  }
+  return res;
+}
+
+std::vector<State> tlEntry::states() const {
+  std::vector<State> res;
+  for (size_t i = 0; i < active.size(); i++) {
+    if (active[i]) {
+      const State &s = base->ta.states[i];
+      res.push_back(State(stateId(i), *s.inv.get(), s.urgent,
+                          keep_initial && s.initial));
+      if (extra_inv) {
+        res.back().inv = FlatCC::conjunction(*s.inv.get(), *extra_inv);
+      }
+    }
+  }
+  return res;
+}
+
+std::vector<Transition> tlEntry::transitions() const {
+  std::vector<Transition> res;
+  for (size_t i = 0; i < base->ta.transitions.size(); i++) {
+    if (!keepsTransition(i)) {
+      continue;
+    }
+    const Transition &trans = base->ta.transitions[i];
+    if (renamed) {
+      res.push_back(Transition(stateId(base->endpoints[i].first),
+                               stateId(base->endpoints[i].second),
+                               trans.action, *trans.guard.get(), trans.update,
+                               trans.sync, true));
+    } else {
+      res.push_back(trans);
+    }
+  }
+  return res;
+}
+
+Automaton tlEntry::toAutomaton() const {
+  Automaton res(states(), transitions(), prefix, false);
+  res.clocks = clocks;
+  res.bool_vars = base->ta.bool_vars;
+  return res;
+}
+
+const Automaton &tlEntry::view(std::optional<Automaton> &buffer) const {
+  bool unchanged = !renamed && !extra_inv && prefix == base->ta.prefix &&
+                   clocks == base->ta.clocks &&
+                   std::all_of(active.begin(), active.end(),
+                               [](bool is_active) { return is_active; });
+  if (unchanged && !keep_initial) {
+    unchanged = std::none_of(base->ta.states.begin(), base->ta.states.end(),
+                             [](const State &s) { return s.initial; });
+  }
+  if (unchanged) {
+    return base->ta;
+  }
+  buffer.emplace(toAutomaton());
+  return *buffer;
+}
@@ -8,6 +8,9 @@
 #pragma once
 
 #include "../constraints/constraints.h"
+#include "../memory_arena.h"
+#include "clock_set.h"
+#include <optional>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -22,49 +25,44 @@ namespace taptenc {
  */
 ///@{
 struct state {
-  ::std::string id;
-  ::std::unique_ptr<ClockConstraint> inv;
+  Symbol id;
+  /** Invariant, shared with all other states having the same invariant. */
+  FlatCCPtr inv;
   bool urgent;
   bool initial;
-  state(::std::string arg_id, const ClockConstraint &inv,
+  state(Symbol arg_id, const ClockConstraint &inv,
         bool arg_urgent = false, bool arg_initial = false);
-  ~state() = default;
-  /** Copy constructor that clones the uniquely managed resources. */
-  state(const state &other);
-  /** Move constructor that steals the uniquely managed resources. */
-  state(state &&other) noexcept;
-  /** Copy assignment using the copy constructor. */
-  state &operator=(const state &other);
-  /** Move assignment swapping all member contents. */
-  state &operator=(state &&other) noexcept;
-  /** Ordering operator determined by comparing string representations. */
+  /**
+   * States are considered equal if they have the same id and invariant,
+   * flags are not taken into account.
+   */
+  bool operator==(const state &r) const {
+    return id == r.id && inv == r.inv;
+  }
+  bool operator!=(const state &r) const { return !(*this == r); }
+  /** Ordering operator consistent with operator==. */
   bool operator<(const state &r) const;
+  /** Hash consistent with operator==. */
+  ::std::size_t hash() const;
 };
 typedef struct state State;
 
-typedef ::std::set<::std::shared_ptr<Clock>> update_t;
+/** Clocks reset by a transition. */
+typedef ClockSet update_t;
 
 struct transition {
-  ::std::string source_id;
-  ::std::string dest_id;
+  Symbol source_id;
+  Symbol dest_id;
   ::std::string action;
-  ::std::unique_ptr<ClockConstraint> guard;
+  /** Guard, shared with all other transitions having the same guard. */
+  FlatCCPtr guard;
   update_t update;
   ::std::string sync;
   bool passive; // true: receiver of sync (?), false: emmitter of sync (!)
-  transition(::std::string arg_source_id, ::std::string arg_dest_id,
+  transition(Symbol arg_source_id, Symbol arg_dest_id,
              std::string arg_action, const ClockConstraint &guard,
              const update_t &arg_update, ::std::string arg_sync,
              bool arg_passive = false);
-  ~transition() = default;
-  /** Copy constructor that clones the uniquely managed resources. */
-  transition(const transition &other);
-  /** Move constructor that steals the uniquely managed resources. */
-  transition(transition &&other) noexcept;
-  /** Copy assignment using the copy constructor. */
-  transition &operator=(const transition &other);
-  /** Move assignment swapping all member contents. */
-  transition &operator=(transition &&other) noexcept;
   /** Composes a string containing all clock updates. */
   ::std::string updateToString() const;
   /**
@@ -77,15 +75,27 @@ struct transition {
    */
   static update_t updateFromString(const ::std::string &update,
                                    const update_t &clocks);
-  /** Ordering operator determined by comparing string representations. */
+  /**
+   * Transitions are considered equal if they connect the same states with
+   * the same guard, update and synchronization. Action name and sync
+   * direction are not taken into account.
+   */
+  bool operator==(const transition &r) const {
+    return source_id == r.source_id && dest_id == r.dest_id &&
+           guard == r.guard && update == r.update && sync == r.sync;
+  }
+  bool operator!=(const transition &r) const { return !(*this == r); }
+  /** Ordering operator consistent with operator==. */
   bool operator<(const transition &r) const;
+  /** Hash consistent with operator==. */
+  ::std::size_t hash() const;
 };
 typedef struct transition Transition;
 
 struct automaton {
   ::std::vector<State> states;
   ::std::vector<Transition> transitions;
-  ::std::set<::std::shared_ptr<Clock>> clocks;
+  ClockSet clocks;
   ::std::vector<::std::string> bool_vars;
   ::std::string prefix;
 
@@ -94,6 +104,74 @@ struct automaton {
             bool setTrap = true);
 };
 typedef struct automaton Automaton;
+
+/**
+ * Adjacency index of an automaton in compressed sparse row format.
+ *
+ * Maps state ids to positions in Automaton::states and stores for each state
+ * the positions of its outgoing and incoming transitions in
+ * Automaton::transitions (in their original order). Transitions with an
+ * endpoint that is not a state of the automaton are not indexed.
+ *
+ * The index is built on demand and becomes stale as soon as states or
+ * transitions of the indexed automaton are changed.
+ */
+struct automatonIndex {
+  /** Contiguous range of positions. */
+  struct range {
+    const ::std::size_t *first;
+    const ::std::size_t *last;
+    const ::std::size_t *begin() const { return first; }
+    const ::std::size_t *end() const { return last; }
+    ::std::size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+  };
+  /** Position returned for unknown state ids. */
+  static constexpr ::std::size_t npos = static_cast<::std::size_t>(-1);
+
+  automatonIndex(const automaton &ta);
+
+  /**
+   * Looks up a state.
+   *
+   * @param id state id
+   * @return position of the state in the indexed automaton or npos
+   */
+  ::std::size_t stateIndex(const Symbol &id) const;
+  bool contains(const Symbol &id) const { return stateIndex(id) != npos; }
+  /**
+   * @param state position of a state
+   * @return positions of the transitions starting in \a state
+   */
+  range outgoing(::std::size_t state) const;
+  /**
+   * @param state position of a state
+   * @return positions of the transitions ending in \a state
+   */
+  range incoming(::std::size_t state) const;
+  /**
+   * @param id state id
+   * @return positions of the transitions starting in state \a id, empty if
+   *         there is no such state
+   */
+  range outgoing(const Symbol &id) const;
+  /**
+   * @param id state id
+   * @return positions of the transitions ending in state \a id, empty if
+   *         there is no such state
+   */
+  range incoming(const Symbol &id) const;
+
+private:
+  ::std::unordered_map<Symbol, ::std::size_t> state_pos;
+  /** out_trans[out_offsets[i]] to out_trans[out_offsets[i+1]] */
+  ::std::vector<::std::size_t> out_offsets;
+  ::std::vector<::std::size_t> out_trans;
+  /** in_trans[in_offsets[i]] to in_trans[in_offsets[i+1]] */
+  ::std::vector<::std::size_t> in_offsets;
+  ::std::vector<::std::size_t> in_trans;
+};
+typedef struct automatonIndex AutomatonIndex;
 ///@}
 
 enum ChanType { Binary = 1, Broadcast = 0 };
@@ -116,7 +194,7 @@ struct channel {
 };
 typedef struct channel Channel;
 struct automataGlobals {
-  ::std::set<::std::shared_ptr<Clock>> clocks;
+  ClockSet clocks;
   ::std::vector<::std::string> bool_vars;
   ::std::vector<Channel> channels;
 };
@@ -130,18 +208,187 @@ typedef struct automataSystem AutomataSystem;
 
 /**
  * @name Encoding related declarations to store automata copies
+ *  - SharedAutomaton (an immutable TA that copies refer to)
  *  - TlEntry (a TA copy together with outgoing transitions)
  *  - TimeLine (a set of TlEntries that can be retrieved via keys)
  *  - TimeLines (a set with TimeLine elements)
  */
 ///@{
+/**
+ * Immutable automaton that is shared by several TlEntry copies.
+ *
+ * Stores the base part of each state id and the positions of all
+ * transition endpoints, so copies can be materialized without lookups.
+ */
+struct sharedAutomaton {
+  const Automaton ta;
+  /** Base part of the id of each state in \a ta (see StateId). */
+  ::std::vector<Symbol> bases;
+  /** Positions of the states of \a ta by their base part. */
+  ::std::unordered_multimap<Symbol, ::std::size_t> base_pos;
+  /** Adjacency index of \a ta. */
+  const AutomatonIndex index;
+  /**
+   * Source and destination position of each transition of \a ta,
+   * AutomatonIndex::npos if an endpoint is not a state of \a ta.
+   */
+  ::std::vector<::std::pair<::std::size_t, ::std::size_t>> endpoints;
+
+  sharedAutomaton(Automaton arg_ta);
+};
+typedef struct sharedAutomaton SharedAutomaton;
+
+/**
+ * Copy of an automaton within a timeline together with the transitions
+ * leading to other copies.
+ *
+ * Copies created during the encoding only differ from the platform automaton
+ * by their prefix, a subset of removed states and additional invariants.
+ * Hence a copy only refers to a shared automaton and stores these
+ * differences, the actual states and transitions are materialized on demand.
+ *
+ * There are two kinds of copies:
+ *  - renamed copies replace each state id by prefix + the base part of the
+ *    id (this is how copies of the platform automaton are named),
+ *  - plain copies keep the state ids of the shared automaton.
+ */
 struct tlEntry {
-  Automaton ta;
+  /** Transitions leading to other copies. */
   ::std::vector<Transition> trans_out;
-  tlEntry(Automaton &arg_ta, ::std::vector<Transition> arg_trans_out);
+  /** Clocks used by the copy. */
+  ClockSet clocks;
+
+  /**
+   * Creates a plain copy of an automaton.
+   *
+   * @param arg_ta automaton to copy, its prefix becomes the copy prefix
+   * @param arg_trans_out outgoing transitions
+   */
+  tlEntry(const Automaton &arg_ta, ::std::vector<Transition> arg_trans_out);
+  /**
+   * Creates a renamed copy of a shared automaton containing all its states.
+   *
+   * @param arg_base shared automaton
+   * @param arg_prefix prefix of the copy
+   * @param arg_trans_out outgoing transitions
+   */
+  tlEntry(::std::shared_ptr<const SharedAutomaton> arg_base, Symbol arg_prefix,
+          ::std::vector<Transition> arg_trans_out);
+
+  /**
+   * Creates a renamed copy with the same states, invariants and clocks as
+   * this one, but without outgoing transitions.
+   *
+   * @param new_prefix prefix of the new copy
+   * @return new copy sharing the automaton of this one
+   */
+  tlEntry rename(Symbol new_prefix) const;
+
+  const Symbol &getPrefix() const { return prefix; }
+  /** @return true iff state ids are prefix + base part (see rename()) */
+  bool isRenamed() const { return renamed; }
+  const SharedAutomaton &getShared() const { return *base; }
+  /** @return number of states of the shared automaton */
+  ::std::size_t sharedSize() const { return active.size(); }
+  /**
+   * @param pos position of a state in the shared automaton
+   * @return true iff the state is part of this copy
+   */
+  bool isActive(::std::size_t pos) const { return active[pos]; }
+  /**
+   * Removes a state (and all adjacent transitions) from this copy.
+   *
+   * @param pos position of the state in the shared automaton
+   */
+  void removeState(::std::size_t pos) { active[pos] = false; }
+  /**
+   * @param pos position of a state in the shared automaton
+   * @return id of the state within this copy
+   */
+  Symbol stateId(::std::size_t pos) const;
+  /**
+   * Renaming keeps the base part, as prefixes end with constants::BASE_SEP.
+   *
+   * @param pos position of a state in the shared automaton
+   * @return base part of the id of the state within this copy
+   */
+  const Symbol &baseOf(::std::size_t pos) const { return base->bases[pos]; }
+  /**
+   * @param id state id
+   * @return true iff this copy contains a state with id \a id
+   */
+  bool containsState(const Symbol &id) const;
+  /**
+   * @param base_id base part of a state id
+   * @return true iff this copy contains a state with base part \a base_id
+   */
+  bool containsBase(const Symbol &base_id) const;
+  /**
+   * Conjoins an invariant to the invariants of all states.
+   *
+   * @param inv invariant to add
+   */
+  void addInvariant(const ClockConstraint &inv);
+  /** Marks all states of this copy as not initial. */
+  void clearInitial() { keep_initial = false; }
+
+  /** @return number of states of this copy, without materializing them */
+  ::std::size_t numStates() const;
+  /**
+   * @return number of transitions of this copy (excluding outgoing ones),
+   *         without materializing them
+   */
+  ::std::size_t numTransitions() const;
+  /** @return states of this copy */
+  ::std::vector<State> states() const;
+  /** @return transitions of this copy (excluding outgoing ones) */
+  ::std::vector<Transition> transitions() const;
+  /** @return automaton formed by this copy */
+  Automaton toAutomaton() const;
+  /**
+   * Provides the automaton formed by this copy without materializing it, if
+   * the copy does not differ from the shared automaton.
+   *
+   * @param buffer receives the automaton formed by this copy if it has to be
+   *               materialized
+   * @return shared automaton or \a buffer
+   */
+  const Automaton &view(::std::optional<Automaton> &buffer) const;
+
+private:
+  ::std::shared_ptr<const SharedAutomaton> base;
+  Symbol prefix;
+  /** True iff state ids are replaced by prefix + base part. */
+  bool renamed;
+  ::std::vector<bool, ArenaAllocator<bool>> active;
+  /** Invariant added to all states, nullptr if there is none. */
+  FlatCCPtr extra_inv;
+  bool keep_initial;
+
+  bool keepsTransition(::std::size_t pos) const;
 };
 typedef struct tlEntry TlEntry;
-typedef ::std::unordered_map<::std::string, TlEntry> TimeLine;
-typedef ::std::unordered_map<::std::string, TimeLine> TimeLines;
+/** TimeLines are built per encoding, their nodes live in the current arena. */
+typedef ::std::unordered_map<
+    Symbol, TlEntry, ::std::hash<Symbol>, ::std::equal_to<Symbol>,
+    ArenaAllocator<::std::pair<const Symbol, TlEntry>>>
+    TimeLine;
+typedef ::std::unordered_map<
+    Symbol, TimeLine, ::std::hash<Symbol>, ::std::equal_to<Symbol>,
+    ArenaAllocator<::std::pair<const Symbol, TimeLine>>>
+    TimeLines;
 ///@}
 } // end namespace taptenc
+
+namespace std {
+template <> struct hash<::taptenc::State> {
+  size_t operator()(const ::taptenc::State &s) const noexcept {
+    return s.hash();
+  }
+};
+template <> struct hash<::taptenc::Transition> {
+  size_t operator()(const ::taptenc::Transition &t) const noexcept {
+    return t.hash();
+  }
+};
+} // end namespace std
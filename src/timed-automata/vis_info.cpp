@@ -67,7 +67,7 @@ systemVisInfo::systemVisInfo(const AutomataSystem &s) {
 }
 
 systemVisInfo::systemVisInfo(const TimeLines &direct_encoding,
-                             const ::std::vector<::std::string> &pa_order) {
+                             const ::std::vector<Symbol> &pa_order) {
   int x_offset = 0;
   int y_offset = 0;
   // the final system consists of only one automaton
@@ -82,13 +82,14 @@ systemVisInfo::systemVisInfo(const TimeLines &direct_encoding,
       int max_x_offset = 0;
       for (const auto &entity : search->second) {
         int min_x_offset = x_offset;
-        auto si = this->generateStateInfo(entity.second.ta.states, x_offset,
-                                          y_offset);
+        Automaton entity_ta = entity.second.toAutomaton();
+        auto si =
+            this->generateStateInfo(entity_ta.states, x_offset, y_offset);
         max_x_offset = std::max(x_offset, max_x_offset);
         x_offset = min_x_offset;
         m_state_info[0].insert(si.begin(), si.end());
         y_offset += COMPONENT_Y_SHIFT;
-        auto ti = this->generateTransitionInfo(entity.second.ta.transitions,
+        auto ti = this->generateTransitionInfo(entity_ta.transitions,
                                                m_state_info.back());
         m_transition_info[0].insert(ti.begin(), ti.end());
       }
@@ -100,10 +101,10 @@ systemVisInfo::systemVisInfo(const TimeLines &direct_encoding,
   auto search = direct_encoding.find(constants::QUERY);
   if (search != direct_encoding.end()) {
     for (const auto &entity : search->second) {
-      auto si =
-          this->generateStateInfo(entity.second.ta.states, x_offset, y_offset);
+      Automaton entity_ta = entity.second.toAutomaton();
+      auto si = this->generateStateInfo(entity_ta.states, x_offset, y_offset);
       m_state_info[0].insert(si.begin(), si.end());
-      auto ti = this->generateTransitionInfo(entity.second.ta.transitions,
+      auto ti = this->generateTransitionInfo(entity_ta.transitions,
                                              m_state_info.back());
       m_transition_info[0].insert(ti.begin(), ti.end());
     }
@@ -117,7 +117,7 @@ public:
    *                 the visual information
    */
   systemVisInfo(const TimeLines &direct_encoding,
-                const ::std::vector<::std::string> &pa_order);
+                const ::std::vector<Symbol> &pa_order);
 
   /**
    * Gets the position of a state.
@@ -6,21 +6,40 @@
 #include "utap_trace_parser.h"
 #include "utap_xml_parser.h"
 #include "printer.h"
+#include "memory_arena.h"
+#include "thread_pool.h"
+#include "encoding_cache.h"
 #include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <future>
+#include <thread>
 #include <stdexcept>
 
 using namespace taptenc;
 
 
-DirectEncoder transformation::createDirectEncoding(
-    AutomataSystem &direct_system, const std::vector<PlanAction> &plan,
-    const std::vector<std::unique_ptr<EncICInfo>> &constraints, int plan_index) {
-  DirectEncoder enc(direct_system, plan);
+namespace {
+/**
+ * Finds the constraint activations of a plan.
+ *
+ * Activations are visited constraint by constraint, each in plan order.
+ *
+ * @param plan_ta the plan TA, its states are sorted by plan order
+ * @param plan the plan used to create \a plan_ta
+ * @param constraints Constraints connecting platform models with plan actions
+ * @param visit called with the constraint, the position of the activating
+ *              plan action in \a plan_ta and the position of the plan action
+ *              ending an until chain (PlanOrderedTLs::npos for other
+ *              constraints)
+ */
+template <class Visitor>
+void forEachActivation(
+    const Automaton &plan_ta, const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints,
+    Visitor visit) {
   for (const auto &gamma : constraints) {
-    for (auto pa = direct_system.instances[plan_index].first.states.begin();
-         pa != direct_system.instances[plan_index].first.states.end(); ++pa) {
+    for (auto pa = plan_ta.states.begin(); pa != plan_ta.states.end(); ++pa) {
 			std::string pa_op = pa->id;
       if (pa->id != constants::START_PA && pa->id != constants::END_PA) {
         pa_op = Filter::getPrefix(pa->id, constants::PA_SEP);
@@ -37,38 +56,13 @@ DirectEncoder transformation::createDirectEncoding(
             return s.ground(plan_action_it->name.args).toString() ==
                    plan_action_it->name.toString();
           });
+      size_t pa_pos = pa - plan_ta.states.begin();
       auto is_active = gamma->activations.end() != pa_trigger;
       if (is_active) {
         switch (gamma->type) {
-        case ICType::Future: {
-          UnaryInfo *info = dynamic_cast<UnaryInfo *>(gamma.get());
-          enc.encodeFuture(direct_system, pa->id, *info);
-        } break;
-        case ICType::Until: {
-          BinaryInfo *info = dynamic_cast<BinaryInfo *>(gamma.get());
-          enc.encodeUntil(direct_system, pa->id, *info);
-        } break;
-        case ICType::Since: {
-          BinaryInfo *info = dynamic_cast<BinaryInfo *>(gamma.get());
-          enc.encodeSince(direct_system, pa->id, *info);
-        } break;
-        case ICType::Past: {
-          UnaryInfo *info = dynamic_cast<UnaryInfo *>(gamma.get());
-          enc.encodePast(direct_system, pa->id, *info);
-        } break;
-        case ICType::NoOp: {
-          UnaryInfo *info = dynamic_cast<UnaryInfo *>(gamma.get());
-          enc.encodeNoOp(direct_system, info->specs.targets, pa->id);
-        } break;
-        case ICType::Invariant: {
-          UnaryInfo *info = dynamic_cast<UnaryInfo *>(gamma.get());
-          enc.encodeInvariant(direct_system, info->specs.targets, pa->id);
-        } break;
         case ICType::UntilChain: {
           ChainInfo *info = dynamic_cast<ChainInfo *>(gamma.get());
-          for (auto epa = pa + 1;
-               epa != direct_system.instances[plan_index].first.states.end();
-               ++epa) {
+          for (auto epa = pa + 1; epa != plan_ta.states.end(); ++epa) {
 						std::string epa_op = Filter::getPrefix(epa->id, constants::PA_SEP);
             auto eplan_action_it = std::find_if(
                 plan.begin(), plan.end(), [epa_op](const auto &act) {
@@ -114,7 +108,7 @@ DirectEncoder transformation::createDirectEncoding(
                 }
               }
               if (!missmatch) {
-                enc.encodeUntilChain(direct_system, *info, pa->id, epa->id);
+                visit(*gamma, pa_pos, size_t(epa - plan_ta.states.begin()));
                 break;
               } else {
               }
@@ -133,71 +127,396 @@ DirectEncoder transformation::createDirectEncoding(
           }
         } break;
         default:
-          throw std::runtime_error("error: no support yet for type ");
+          visit(*gamma, pa_pos, PlanOrderedTLs::npos);
         }
       }
     }
   }
+}
+
+/**
+ * Encodes the constraints activated by plan actions from a given position of
+ * the plan automaton on.
+ *
+ * Until chains that are activated before \a first_pos are assumed to be
+ * encoded already if they also end before it.
+ *
+ * @param enc encoder to apply the constraints to
+ * @param direct_system the system containing the platform TA and the plan TA
+ * @param plan the plan used to create the plan TA from the \a direct_system
+ * @param constraints Constraints connecting platform models with plan actions
+ * @param plan_index index of the plan TA inside \a direct_system
+ * @param first_pos position of the first plan action whose constraints are
+ *                  encoded
+ * @return lowest position of a timeline before \a first_pos that had to be
+ *         modified, PlanOrderedTLs::npos if there is none
+ */
+size_t encodeActivations(
+    DirectEncoder &enc, AutomataSystem &direct_system,
+    const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints, int plan_index,
+    size_t first_pos) {
+  size_t conflict = PlanOrderedTLs::npos;
+  size_t num_prev_activations = enc.getActivations().size();
+  const Automaton &plan_ta = direct_system.instances[plan_index].first;
+  forEachActivation(plan_ta, plan, constraints, [&](const EncICInfo &gamma,
+                                                    size_t pa_pos,
+                                                    size_t epa_pos) {
+    if (pa_pos < first_pos) {
+      // the end of an until chain may lie behind first_pos
+      if (epa_pos != PlanOrderedTLs::npos && epa_pos >= first_pos) {
+        conflict = std::min(conflict, pa_pos - 1);
+      }
+      return;
+    }
+    std::string pa = plan_ta.states[pa_pos].id;
+    switch (gamma.type) {
+    case ICType::Future: {
+      const UnaryInfo &info = dynamic_cast<const UnaryInfo &>(gamma);
+      enc.encodeFuture(direct_system, pa, info);
+    } break;
+    case ICType::Until: {
+      const BinaryInfo &info = dynamic_cast<const BinaryInfo &>(gamma);
+      enc.encodeUntil(direct_system, pa, info);
+    } break;
+    case ICType::Since: {
+      const BinaryInfo &info = dynamic_cast<const BinaryInfo &>(gamma);
+      enc.encodeSince(direct_system, pa, info);
+    } break;
+    case ICType::Past: {
+      const UnaryInfo &info = dynamic_cast<const UnaryInfo &>(gamma);
+      enc.encodePast(direct_system, pa, info);
+    } break;
+    case ICType::NoOp: {
+      const UnaryInfo &info = dynamic_cast<const UnaryInfo &>(gamma);
+      enc.encodeNoOp(direct_system, info.specs.targets, pa);
+    } break;
+    case ICType::Invariant: {
+      const UnaryInfo &info = dynamic_cast<const UnaryInfo &>(gamma);
+      enc.encodeInvariant(direct_system, info.specs.targets, pa);
+    } break;
+    case ICType::UntilChain: {
+      const ChainInfo &info = dynamic_cast<const ChainInfo &>(gamma);
+      enc.encodeUntilChain(direct_system, info, pa,
+                           plan_ta.states[epa_pos].id);
+    } break;
+    default:
+      throw std::runtime_error("error: no support yet for type ");
+    }
+  });
+  const auto &activations = enc.getActivations();
+  for (size_t i = num_prev_activations; i < activations.size(); i++) {
+    if (activations[i].first < first_pos) {
+      conflict = std::min(conflict, activations[i].first);
+    }
+  }
+  return conflict;
+}
+} // end anonymous namespace
+
+DirectEncoder transformation::createDirectEncoding(
+    AutomataSystem &direct_system, const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints, int plan_index) {
+  DirectEncoder enc(direct_system, plan);
+  encodeActivations(enc, direct_system, plan, constraints, plan_index, 0);
   return enc;
 }
 
+EncodingEstimate transformation::estimateDirectEncoding(
+    const Automaton &platform, const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints) {
+  // the base timelines only refer to the platform, so they are cheap
+  AutomataSystem scratch_system;
+  scratch_system.instances.push_back(std::make_pair(platform, ""));
+  DirectEncoder enc(scratch_system, plan);
+  EncodingEstimate res = enc.estimateBase(platform);
+  const Automaton &plan_ta =
+      scratch_system.instances[enc.getPlanTAIndex()].first;
+  forEachActivation(plan_ta, plan, constraints, [&](const EncICInfo &gamma,
+                                                    size_t pa_pos,
+                                                    size_t epa_pos) {
+    std::string end_pa = "";
+    if (epa_pos != PlanOrderedTLs::npos) {
+      end_pa = plan_ta.states[epa_pos].id;
+    }
+    enc.estimateActivation(res, platform, gamma, plan_ta.states[pa_pos].id,
+                           end_pa);
+  });
+  return res;
+}
+
+/**
+ * \internal
+ * Constraints activated within the reused timelines are skipped. If one of
+ * the remaining constraints reaches back into the reused timelines, it
+ * would have been encoded before some of the skipped ones, hence the
+ * encoding is retried with less reused timelines.
+ * \endinternal
+ */
+DirectEncoder transformation::updateDirectEncoding(
+    const DirectEncoder &prev, AutomataSystem &direct_system,
+    const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints, int plan_index) {
+  AutomataSystem base_system = direct_system;
+  size_t keep = prev.reusableTimelines(plan);
+  while (keep > 0) {
+    DirectEncoder enc(prev, direct_system, plan, keep);
+    size_t conflict = encodeActivations(enc, direct_system, plan, constraints,
+                                        plan_index, keep);
+    if (conflict >= keep) {
+      std::cout << "transformation updateDirectEncoding: reused " << keep
+                << " timelines" << std::endl;
+      return enc;
+    }
+    direct_system = base_system;
+    keep = prev.reusableTimelines(plan, conflict);
+  }
+  return createDirectEncoding(direct_system, plan, constraints, plan_index);
+}
+
 
-timed_trace_t transformation::transform_plan(const std::vector<PlanAction> &plan, const std::vector<Automaton> &platform_models, const Constraints &platform_constraints) {
+/**
+ * \internal
+ * Each round merges neighbouring encodings, so the components of merged
+ * state ids keep the platform order that the product automaton uses for
+ * reconstructing the trace.
+ * \endinternal
+ */
+ArenaOwned<DirectEncoder> transformation::mergeDirectEncodings(
+    std::vector<ArenaOwned<DirectEncoder>> encodings, ThreadPool &pool,
+    const EncodingBudget &budget) {
+  if (encodings.empty()) {
+    return ArenaOwned<DirectEncoder>::build([]() { return DirectEncoder(); });
+  }
+  // platforms covered by each encoding, for diagnostics
+  std::vector<std::pair<size_t, size_t>> platforms;
+  for (size_t i = 0; i < encodings.size(); i++) {
+    platforms.push_back(std::make_pair(i, i));
+  }
+  while (encodings.size() > 1) {
+    std::vector<std::future<ArenaOwned<DirectEncoder>>> merges;
+    for (size_t i = 0; i + 1 < encodings.size(); i += 2) {
+      merges.push_back(pool.submit([&encodings, i]() {
+        return ArenaOwned<DirectEncoder>::build([&encodings, i]() {
+          return encodings[i]->mergeEncodings(*encodings[i + 1]);
+        });
+      }));
+    }
+    // the merges refer to the encodings of this round, so all of them have
+    // to finish before a failed one is reported
+    for (const auto &merge : merges) {
+      merge.wait();
+    }
+    std::vector<ArenaOwned<DirectEncoder>> merged;
+    std::vector<std::pair<size_t, size_t>> merged_platforms;
+    for (size_t i = 0; i < merges.size(); i++) {
+      merged.push_back(merges[i].get());
+      merged_platforms.push_back(std::make_pair(platforms[2 * i].first,
+                                                platforms[2 * i + 1].second));
+    }
+    if (encodings.size() % 2 == 1) {
+      merged.push_back(std::move(encodings.back()));
+      merged_platforms.push_back(platforms.back());
+    }
+    // releases the merged encodings together with their arenas
+    encodings = std::move(merged);
+    platforms = std::move(merged_platforms);
+    if (budget.limited()) {
+      for (size_t i = 0; i < encodings.size(); i++) {
+        budget.check(encodings[i]->measure(),
+                     "merge of platforms " +
+                         std::to_string(platforms[i].first) + "-" +
+                         std::to_string(platforms[i].second));
+      }
+    }
+  }
+  return std::move(encodings.front());
+}
+
+
+namespace {
+/**
+ * Final encoding of a plan together with the automata that are needed to
+ * obtain the timed trace from a symbolic trace of the encoding.
+ */
+struct planEncoding {
+  AutomataSystem system;
+  Automaton product_ta = Automaton({}, {}, "", false);
+  Automaton plan_ta = Automaton({}, {}, "", false);
+  /** Key to store the result with (see EncodingCache). */
+  std::string cache_key;
+};
+typedef struct planEncoding PlanEncoding;
+
+/**
+ * Solves the reachability problem of an encoded plan and stores the result
+ * in the encoding cache if it is a fastest trace.
+ *
+ * @param encoding encoded plan
+ * @return timed trace reflecting the resulting temporal plan
+ */
+timed_trace_t solvePlanEncoding(const PlanEncoding &encoding) {
+  UTAPTraceParser trace_parser = UTAPTraceParser(encoding.system);
+  // retrieve the solution trace
+  if (!trace_parser.solveTrace(encoding.system, "merged",
+                               uppaalcalls::QUERY_STR)) {
+    return timed_trace_t();
+  }
+  timed_trace_t res =
+      trace_parser.getTimedTrace(encoding.product_ta, encoding.plan_ta);
+  // arbitrary traces of a solver portfolio are not reproducible
+  if (!res.empty() && trace_parser.fastestTrace()) {
+    EncodingCache().store(encoding.cache_key, res);
+  }
+  return res;
+}
+
+/**
+ * Encodes a plan unless its result is cached (see
+ * transformation::transform_plan()).
+ *
+ * @param res receives the encoding
+ * @param cached_trace receives the cached result
+ * @return false iff the result was cached
+ */
+bool encodePlan(const std::vector<PlanAction> &plan, const std::vector<Automaton> &platform_models, const transformation::Constraints &platform_constraints, bool minimize, const EncodingBudget &budget, PlanEncoding &res, timed_trace_t &cached_trace) {
 	assert(platform_models.size() == platform_constraints.size());
-	XMLPrinter printer;
-    DirectEncoder merge_enc;
+    // repeated requests are answered without encoding and solving
+    EncodingCache cache;
+    std::string cache_key = EncodingCache::key(
+        plan, platform_models, platform_constraints,
+        "minimize " + std::to_string(minimize) + ", query " +
+            uppaalcalls::QUERY_STR + ", " +
+            UTAPTraceParser::solverConfiguration());
+    if (cache.lookup(cache_key, cached_trace)) {
+      std::cout << "transform_plan: use cached trace" << std::endl;
+      return false;
+    }
+    if (budget.limited()) {
+      // abort before the encoding runs out of memory
+      EncodingEstimate merged_estimate;
+      for (size_t j = 0; j < platform_models.size(); j++) {
+        EncodingEstimate estimate = transformation::estimateDirectEncoding(
+            platform_models[j], plan, platform_constraints[j]);
+        budget.check(estimate, "encoding of platform " + std::to_string(j) +
+                                   " (predicted)");
+        merged_estimate =
+            (j == 0) ? estimate : merged_estimate.merge(estimate);
+        budget.check(merged_estimate, "merge of platforms 0-" +
+                                          std::to_string(j) + " (predicted)");
+      }
+      std::cout << "transform_plan: predicted " << merged_estimate.numStates()
+                << " states and " << merged_estimate.numTransitions()
+                << " transitions" << std::endl;
+    }
+    // each platform is encoded on its own thread in its own arena, which is
+    // released as soon as the encoding is merged
+    std::vector<AutomataSystem> base_systems(platform_models.size());
+    std::vector<std::future<ArenaOwned<DirectEncoder>>> platform_encodings;
+    ThreadPool pool(std::min<size_t>(
+        std::max(1u, std::thread::hardware_concurrency()),
+        platform_models.size()));
+    for (long unsigned int j = 0; j < platform_models.size(); j++) {
+      base_systems[j].instances.push_back(
+          std::make_pair(platform_models[j], ""));
+      // encode the j-th platform ta
+      platform_encodings.push_back(pool.submit([&, j]() {
+        return ArenaOwned<DirectEncoder>::build([&, j]() {
+          return transformation::createDirectEncoding(
+              base_systems[j], plan, platform_constraints[j]);
+        });
+      }));
+    }
 	  AutomataSystem merged_system;
     Automaton product_ta = platform_models[0];
-    AutomataSystem base_system;
 		Automaton plan_ta = platform_models[0];
 		std::cout << platform_models.size() << std::endl;
+    std::vector<ArenaOwned<DirectEncoder>> encodings;
     for (long unsigned int j = 0; j < platform_models.size(); j++) {
-      AutomataSystem base_system;
-      base_system.instances.push_back(std::make_pair(platform_models[j], ""));
-			// encode the j-th platform ta
-      DirectEncoder curr_encoder =
-          transformation::createDirectEncoding(base_system, plan, platform_constraints[j]);
         if (j > 0) {
-          product_ta = PlanOrderedTLs::productTA(product_ta, platform_models[j],
-                                                 "product", true);
-			// merge the encoding of the j-th platform ta into the full encoding
-			std::cout << "start merging of the " << j << "-th encoding" << std::endl;
-        merge_enc = merge_enc.mergeEncodings(curr_encoder);
-			std::cout << "done" << std::endl;
-        } else {
+          // only reachable product states can occur in a trace
+          product_ta = PlanOrderedTLs::reachableProductTA(
+              product_ta, platform_models[j], "product", true);
+        }
+      // wait for the encoding of the j-th platform ta
+      encodings.push_back(platform_encodings[j].get());
+      if (budget.limited()) {
+        // predictions may be too optimistic, stop before merging
+        budget.check(encodings[j]->measure(),
+                     "encoding of platform " + std::to_string(j));
+      }
+        if (j == 0) {
 				// init the full encoding with the instances of the first encoding
-        merged_system.instances = base_system.instances;
-				merge_enc = curr_encoder.copy();
-				plan_ta = base_system.instances[curr_encoder.getPlanTAIndex()].first;
+        merged_system.instances = base_systems[j].instances;
+				plan_ta = base_systems[j].instances[encodings[j]->getPlanTAIndex()].first;
       }
 			// extract all clocks from the transformed system
-      SystemVisInfo tmp_vis_info;
-      AutomataSystem direct_system =
-          curr_encoder.createFinalSystem(base_system, tmp_vis_info);
-				std::cout << "curr " << j << " num states:"
-             << direct_system.instances[0].first.states.size()
-             << std::endl;
-      merged_system.globals.clocks.insert(direct_system.globals.clocks.begin(),
-                                          direct_system.globals.clocks.end());
+      merged_system.globals.clocks |= base_systems[j].globals.clocks;
     }
 			std::cout << "finished loop" << std::endl;
-      SystemVisInfo merged_system_vis_info;
-			// finalize the encoding and obtain the visual information for printing
-        AutomataSystem final_merged_system =
-            merge_enc.createFinalSystem(merged_system, merged_system_vis_info);
+			// merge the encodings of all platform tas into the full encoding
+			std::cout << "start merging of " << encodings.size() << " encodings" << std::endl;
+      AutomataSystem final_merged_system;
+      {
+        ArenaOwned<DirectEncoder> merge_enc =
+            transformation::mergeDirectEncodings(std::move(encodings), pool,
+                                                 budget);
+        std::cout << "done" << std::endl;
+        // finalize the encoding, afterwards the timelines (and their arena)
+        // are released
+        final_merged_system = merge_enc->createFinalSystem(merged_system);
+      }
+        budget.check(final_merged_system.instances[0].first, "final encoding");
+        if (minimize) {
+          for (size_t i = 0; i < final_merged_system.instances.size(); i++) {
+            Automaton &ta = final_merged_system.instances[i].first;
+            size_t num_states = ta.states.size();
+            ta = encoderutils::minimizeAutomaton(ta);
+            std::cout << "minimized " << ta.prefix << " from " << num_states
+                      << " to " << ta.states.size() << " states" << std::endl;
+          }
+        }
 			  std::cout << "start printing" << std::endl;
 				std::cout << "merged num states:"
              << final_merged_system.instances[0].first.states.size()
              << std::endl;
-				// print encoded ta to xml
-        printer.print(final_merged_system, merged_system_vis_info,
-                      "merged.xml");
-				// solve the encoded reachability problem
-        auto uppaal_time = uppaalcalls::solve("merged");
-        UTAPTraceParser trace_parser = UTAPTraceParser(final_merged_system);
-        // retrieve the solution trace
-        trace_parser.parseTraceInfo("merged.trace");
-        return trace_parser.getTimedTrace(
-            product_ta,
-            plan_ta);
+        res.system = std::move(final_merged_system);
+        res.product_ta = std::move(product_ta);
+        res.plan_ta = std::move(plan_ta);
+        res.cache_key = cache_key;
+        return true;
+}
+} // end anonymous namespace
+
+timed_trace_t transformation::transform_plan(const std::vector<PlanAction> &plan, const std::vector<Automaton> &platform_models, const Constraints &platform_constraints, bool minimize, const EncodingBudget &budget) {
+  PlanEncoding encoding;
+  timed_trace_t cached_trace;
+  if (!encodePlan(plan, platform_models, platform_constraints, minimize, budget,
+                  encoding, cached_trace)) {
+    return cached_trace;
+  }
+  // solve the encoded reachability problem
+  return solvePlanEncoding(encoding);
+}
+
+std::future<timed_trace_t> transformation::transform_plan_async(
+    const std::vector<PlanAction> &plan,
+    const std::vector<Automaton> &platform_models,
+    const Constraints &platform_constraints,
+    uppaalcalls::SolverPool &solver_pool, bool minimize,
+    const EncodingBudget &budget) {
+  auto encoding = std::make_shared<PlanEncoding>();
+  timed_trace_t cached_trace;
+  if (!encodePlan(plan, platform_models, platform_constraints, minimize, budget,
+                  *encoding, cached_trace)) {
+    std::promise<timed_trace_t> cached;
+    cached.set_value(std::move(cached_trace));
+    return cached.get_future();
+  }
+  // the encoding is destroyed before the result is handed out, so callers may
+  // release its symbols once the result is ready (see Symbol::release())
+  return solver_pool.submit([encoding]() mutable {
+    std::shared_ptr<PlanEncoding> solved = std::move(encoding);
+    return solvePlanEncoding(*solved);
+  });
 }
@@ -9,11 +9,16 @@
 
 #include <vector>
 #include <memory>
+#include <future>
 #include "encoders.h"
 #include "timed_automata.h"
 #include "enc_interconnection_info.h"
 #include "constraints.h"
 #include "utap_trace_parser.h"
+#include "memory_arena.h"
+#include "thread_pool.h"
+#include "encoding_estimate.h"
+#include "uppaal_calls.h"
 
 namespace taptenc {
 namespace transformation {
@@ -30,15 +35,93 @@ typedef std::vector<std::vector<std::unique_ptr<EncICInfo>>> Constraints;
 DirectEncoder createDirectEncoding(
     AutomataSystem &direct_system, const std::vector<PlanAction> &plan,
     const std::vector<std::unique_ptr<EncICInfo>> &constraints, int plan_index = 1);
+/**
+ * Predict the size of the direct encoding of a platform TA without building
+ * it.
+ *
+ * @param platform the platform TA
+ * @param plan the plan to encode
+ * @param constraints Constraints connecting the platform model with plan
+ *                    actions
+ * @return predicted size, merged encodings are predicted by
+ *         EncodingEstimate::merge()
+ */
+EncodingEstimate estimateDirectEncoding(
+    const Automaton &platform, const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints);
+/**
+ * Apply the direct encoding for a plan that extends or replans the suffix of
+ * a previously encoded plan.
+ *
+ * Timelines of the shared prefix are taken from the previous encoding unless
+ * a constraint window reaches into the changed suffix, only the remaining
+ * constraints are encoded again.
+ *
+ * @param prev encoding of the previous plan, created with the same
+ *             platform TA and constraints
+ * @param direct_system the system containing the platform TA
+ * @param plan the changed plan
+ * @param constraints Constraints connecting platform models with plan actions
+ * @param plan_index index of the plan TA inside \a direct_system
+ * @return Encoder holding the direct encoding construction of \a plan
+ */
+DirectEncoder updateDirectEncoding(
+    const DirectEncoder &prev, AutomataSystem &direct_system,
+    const std::vector<PlanAction> &plan,
+    const std::vector<std::unique_ptr<EncICInfo>> &constraints, int plan_index = 1);
+/**
+ * Merge encodings of several platform models pairwise in a balanced tree.
+ *
+ * Merges of the same tree level are independent and run concurrently.
+ *
+ * Each merge builds its result in an arena of its own, the merged
+ * encodings (and their arenas) are released after each tree level.
+ *
+ * @param encodings encodings of the platform models in platform order
+ * @param pool pool that runs the merges
+ * @param budget budget the encodings of each tree level are checked against
+ * @return merged encoding
+ * @throw BudgetExceededError if a merged encoding exceeds \a budget
+ */
+ArenaOwned<DirectEncoder>
+mergeDirectEncodings(std::vector<ArenaOwned<DirectEncoder>> encodings,
+                     ThreadPool &pool,
+                     const EncodingBudget &budget = EncodingBudget());
 /**
  * Transform a plan according to a platform models and constraints
  *
  * @param plan Plan to transform
  * @param platform_models platform models realizing platform specific behavior
  * @param platform_constraints Constraints connecting platform models with plan actions
+ * @param minimize if true, bisimilar states of the final encoding are merged
+ *                 before it is handed to the solver
+ * @param budget limits the size of the encoding, it is checked against the
+ *               predicted sizes before encoding and against the final
+ *               encoding before solving
  * @return timed trace reflecting the resulting temporal plan
+ * @throw BudgetExceededError if the encoding exceeds \a budget
+ */
+timed_trace_t transform_plan(const std::vector<PlanAction> &plan, const std::vector<Automaton> &platform_models, const Constraints &platform_constraints, bool minimize = false, const EncodingBudget &budget = EncodingBudget::fromEnv());
+/**
+ * Transform a plan like transform_plan(), but only encode it on the calling
+ * thread and solve the encoding on a solver pool.
+ *
+ * This way the encoding of the next plan overlaps with solving the previous
+ * one.
+ *
+ * @param plan Plan to transform
+ * @param platform_models platform models realizing platform specific behavior
+ * @param platform_constraints Constraints connecting platform models with plan actions
+ * @param solver_pool pool that solves the encoding, it has to outlive the
+ *                    returned future
+ * @param minimize if true, bisimilar states of the final encoding are merged
+ *                 before it is handed to the solver
+ * @param budget limits the size of the encoding
+ * @return future holding the timed trace reflecting the resulting temporal
+ *         plan, the encoding is destroyed before it becomes ready
+ * @throw BudgetExceededError if the encoding exceeds \a budget
  */
-timed_trace_t transform_plan(const std::vector<PlanAction> &plan, const std::vector<Automaton> &platform_models, const Constraints &platform_constraints);
+std::future<timed_trace_t> transform_plan_async(const std::vector<PlanAction> &plan, const std::vector<Automaton> &platform_models, const Constraints &platform_constraints, uppaalcalls::SolverPool &solver_pool, bool minimize = false, const EncodingBudget &budget = EncodingBudget::fromEnv());
 
 } // end namespace transformation
 } // end namespace taptenc
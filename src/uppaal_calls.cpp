@@ -10,15 +10,49 @@
 #include "printer/printer.h"
 #include "timed-automata/timed_automata.h"
 #include "utils.h"
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 namespace taptenc {
 namespace uppaalcalls {
+SolverSession::SolverSession(bool keep_files) : keep_files(keep_files) {
+  const char *tmp_dir = std::getenv("TMPDIR");
+  std::string dir_template =
+      ((tmp_dir == nullptr || *tmp_dir == '\0') ? "/tmp" : tmp_dir) +
+      std::string("/taptenc-XXXXXX");
+  if (mkdtemp(dir_template.data()) == nullptr) {
+    throw std::runtime_error(
+        "SolverSession: cannot create temporary directory " + dir_template +
+        ": " + std::strerror(errno));
+  }
+  dir = dir_template;
+}
+
+SolverSession::~SolverSession() {
+  if (!keep_files) {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+  }
+}
+
+std::string SolverSession::path(const std::string &name) const {
+  return (std::filesystem::path(dir) / name).string();
+}
+
 void deleteEmptyLines(const std::string &file_name) {
   std::string bufferString = "";
 
@@ -93,7 +127,7 @@ std::string exec(const char *cmd) {
   auto t2 = std::chrono::high_resolution_clock::now();
   res.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1));
   std::string call_get_trace = getEnvVar("VERIFYTA_DIR") +
-                               "/verifyta -t 2  -f " + file_name + " -Y " +
+                               "/verifyta " + SOLVE_OPTIONS + "  -f " + file_name + " -Y " +
                                file_name + ".xml " + file_name + ".q";
   std::filesystem::remove(file_name + "-1.xtr");
   t1 = std::chrono::high_resolution_clock::now();
@@ -117,5 +151,170 @@ std::string exec(const char *cmd) {
   }
   return res;
 }
+
+std::vector<SolverConfig> defaultPortfolio() {
+  return {{"fastest", "-t 2"},
+          {"bfs", "-t 0 -o 0"},
+          {"dfs", "-t 0 -o 1"},
+          {"rdfs", "-t 0 -o 2"},
+          {"rdfs-S2", "-t 0 -o 2 -S 2"}};
+}
+
+/**
+ * \internal
+ * Each configuration runs in its own child process writing its output and
+ * trace to files named after the configuration. The children are polled
+ * individually (instead of waiting for any child) to not interfere with
+ * other child processes of the program.
+ * \endinternal
+ */
+PortfolioResult solvePortfolio(const AutomataSystem &sys,
+                               std::string file_name, std::string query_str,
+                               const std::vector<SolverConfig> &configs) {
+  PortfolioResult res{PortfolioResult::npos, false,
+                      std::vector<timedelta>(configs.size(), timedelta(0))};
+  XMLPrinter printer;
+  SystemVisInfo sys_vis_info(sys);
+  printer.print(sys, sys_vis_info, file_name + ".xml");
+  std::ofstream query_file(file_name + ".q", std::ios_base::trunc);
+  query_file << query_str;
+  query_file.close();
+  std::string verifyta = getEnvVar("VERIFYTA_DIR") + "/verifyta";
+  std::string call_get_if = "UPPAAL_COMPILE_ONLY=1 " + verifyta + " " +
+                            file_name + ".xml - > " + file_name + ".if";
+  std::system(call_get_if.c_str());
+  // everything the children need is prepared before forking, so they only
+  // call async-signal-safe functions until exec
+  std::vector<std::vector<std::string>> args(configs.size());
+  std::vector<std::string> out_paths;
+  for (size_t i = 0; i < configs.size(); i++) {
+    args[i].push_back(verifyta);
+    std::istringstream options(configs[i].options);
+    std::string option;
+    while (options >> option) {
+      args[i].push_back(option);
+    }
+    args[i].insert(args[i].end(),
+                   {"-f", file_name + "-" + configs[i].name, "-Y",
+                    file_name + ".xml", file_name + ".q"});
+    out_paths.push_back(file_name + "-" + configs[i].name + ".out");
+  }
+  std::vector<std::vector<char *>> argvs(configs.size());
+  for (size_t i = 0; i < configs.size(); i++) {
+    for (auto &arg : args[i]) {
+      argvs[i].push_back(arg.data());
+    }
+    argvs[i].push_back(nullptr);
+  }
+  // descriptors inherited from the parent (e.g. files of concurrent calls)
+  // are closed in the children
+  long max_fd = sysconf(_SC_OPEN_MAX);
+  if (max_fd < 0) {
+    max_fd = 1024;
+  }
+  std::vector<pid_t> pids(configs.size(), -1);
+  std::vector<std::string> outcomes(configs.size(), "killed");
+  auto start = std::chrono::high_resolution_clock::now();
+  auto elapsed = [&start]() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::high_resolution_clock::now() - start);
+  };
+  for (size_t i = 0; i < configs.size(); i++) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // own process group, so killing it also stops helper processes
+      setpgid(0, 0);
+      int fd = open(out_paths[i].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+      }
+      for (long other = STDERR_FILENO + 1; other < max_fd; other++) {
+        close(static_cast<int>(other));
+      }
+      execv(argvs[i][0], argvs[i].data());
+      _exit(127);
+    }
+    if (pid < 0) {
+      std::cout << "uppaalcalls solvePortfolio: cannot start "
+                << configs[i].name << ": " << std::strerror(errno)
+                << std::endl;
+      outcomes[i] = "not started";
+    } else {
+      setpgid(pid, pid);
+    }
+    pids[i] = pid;
+  }
+  size_t running = std::count_if(pids.begin(), pids.end(),
+                                 [](pid_t pid) { return pid > 0; });
+  while (running > 0 && res.winner == PortfolioResult::npos) {
+    bool reaped = false;
+    for (size_t i = 0; i < configs.size() && res.winner == PortfolioResult::npos;
+         i++) {
+      int status = 0;
+      if (pids[i] <= 0 || waitpid(pids[i], &status, WNOHANG) != pids[i]) {
+        continue;
+      }
+      pids[i] = -1;
+      running--;
+      reaped = true;
+      res.timings[i] = elapsed();
+      std::ifstream out_file(out_paths[i]);
+      std::stringstream output;
+      output << out_file.rdbuf();
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+          output.str().find("Formula is") != std::string::npos) {
+        res.winner = i;
+        res.satisfied =
+            output.str().find("Formula is satisfied") != std::string::npos;
+        outcomes[i] = "answered";
+      } else {
+        outcomes[i] = "failed";
+      }
+    }
+    if (!reaped) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  for (size_t i = 0; i < configs.size(); i++) {
+    if (pids[i] > 0) {
+      kill(-pids[i], SIGKILL);
+      waitpid(pids[i], nullptr, 0);
+      res.timings[i] = elapsed();
+    }
+  }
+  if (res.winner == PortfolioResult::npos) {
+    std::cout << "uppaalcalls solvePortfolio: no configuration answered"
+              << std::endl;
+  } else {
+    std::cout << "uppaalcalls solvePortfolio: " << configs[res.winner].name
+              << " answered first" << std::endl;
+  }
+  for (size_t i = 0; i < configs.size(); i++) {
+    std::cout << "  " << configs[i].name << " (" << configs[i].options
+              << "): " << res.timings[i].count() << " ms, " << outcomes[i]
+              << std::endl;
+  }
+  if (res.winner != PortfolioResult::npos && res.satisfied) {
+    std::error_code ec;
+    std::filesystem::rename(file_name + "-" + configs[res.winner].name +
+                                "-1.xtr",
+                            file_name + "-1.xtr", ec);
+    if (ec) {
+      std::cout << "uppaalcalls solvePortfolio: no trace of "
+                << configs[res.winner].name << ": " << ec.message()
+                << std::endl;
+      res.satisfied = false;
+      return res;
+    }
+    deleteEmptyLines(file_name + "-1.xtr");
+    std::filesystem::remove(file_name + ".trace");
+    std::string call_make_trace_readable = "tracer " + file_name + ".if " +
+                                           file_name + "-1.xtr > " + file_name +
+                                           ".trace";
+    std::system(call_make_trace_readable.c_str());
+  }
+  return res;
+}
 } // end namespace uppaalcalls
 } // end namespace taptenc
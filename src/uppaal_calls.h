@@ -9,9 +9,13 @@
 #pragma once
 
 #include "constants.h"
+#include "thread_pool.h"
 #include "timed-automata/timed_automata.h"
 #include <chrono>
+#include <cstddef>
+#include <future>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace taptenc {
@@ -20,7 +24,84 @@ namespace uppaalcalls {
 typedef ::std::chrono::duration<long, std::milli> timedelta;
 /** Default query string. */
 constexpr char QUERY_STR[]{"E<> sys_direct.AqueryA"};
+/** Options of verifyta used by solve(), they request the fastest trace. */
+constexpr char SOLVE_OPTIONS[]{"-t 2"};
 constexpr char TAPTENC_TEMP_XML[]{"taptenc_temp"};
+
+/**
+ * Private working directory for the files of solver calls.
+ *
+ * Each session creates a fresh directory (via mkdtemp) below the directory
+ * named by the environment variable TMPDIR or /tmp, so concurrent solver
+ * calls within one process or from several processes do not overwrite each
+ * other's .xml, .q, .if, .xtr and .trace files. The directory and its
+ * content are removed when the session is destroyed.
+ */
+class SolverSession {
+public:
+  /**
+   * Creates the session directory.
+   *
+   * @param keep_files if true, the directory is not removed on destruction
+   * @throw std::runtime_error if the directory cannot be created
+   */
+  explicit SolverSession(bool keep_files = false);
+  ~SolverSession();
+  SolverSession(const SolverSession &) = delete;
+  SolverSession &operator=(const SolverSession &) = delete;
+
+  /**
+   * @param name file name without directory
+   * @return path of the file within the session directory
+   */
+  ::std::string path(const ::std::string &name) const;
+  /** @return path of the session directory */
+  const ::std::string &directory() const { return dir; }
+
+private:
+  ::std::string dir;
+  bool keep_files;
+};
+
+/**
+ * Bounded pool for solver calls.
+ *
+ * At most a fixed number of submitted solver jobs run at once, the others
+ * are queued in the order of submission. verifyta has no persistent mode
+ * that could answer several queries, hence the pool bounds the number of
+ * concurrent solver processes instead of keeping them alive.
+ *
+ * Destroying the pool waits until all submitted jobs are done.
+ */
+class SolverPool {
+public:
+  /**
+   * Creates a pool.
+   *
+   * @param max_concurrent maximal number of jobs running at once, 0 selects
+   *                       the number of hardware threads
+   */
+  explicit SolverPool(::std::size_t max_concurrent = 0)
+      : pool(max_concurrent) {}
+
+  /**
+   * Schedules a solver job.
+   *
+   * @param job callable without arguments that calls the solver
+   * @return future holding the result (or exception) of \a job
+   */
+  template <class F>
+  ::std::future<::std::invoke_result_t<F>> submit(F &&job) {
+    return pool.submit(::std::forward<F>(job));
+  }
+
+  /** @return maximal number of jobs running at once */
+  ::std::size_t size() const { return pool.size(); }
+
+private:
+  ThreadPool pool;
+};
+
 /**
  * Deletes empty lines from a file.
  *
@@ -42,7 +123,9 @@ std::string getEnvVar(std::string const &key);
  * Call the verifyta solver and the tracer from the utap lib to solve a query
  * for a given xml system.
  *
- * @param file_name name of xml system file without .xml
+ * @param file_name name of xml system file without .xml, use
+ *                  SolverSession::path() to avoid collisions with
+ *                  concurrent calls
  * @param query_str query string suitable for uppaal
  *
  * @return time measures for the two calls to verifyta and if the query is
@@ -56,7 +139,9 @@ std::string getEnvVar(std::string const &key);
  * for a given automata system.
  *
  * @param sys automata system to solve the query for
- * @param file_name name of xml system file without .xml
+ * @param file_name name of xml system file without .xml, use
+ *                  SolverSession::path() to avoid collisions with
+ *                  concurrent calls
  * @param query_str query string sutiable for uppaal
  *
  * @return time measures for the two calls to verifyta and if the query is
@@ -65,5 +150,67 @@ std::string getEnvVar(std::string const &key);
 ::std::vector<timedelta> solve(const AutomataSystem &sys,
                                ::std::string file_name = TAPTENC_TEMP_XML,
                                ::std::string query_str = QUERY_STR);
+
+/**
+ * Options of a verifyta call within a solver portfolio.
+ */
+struct solverConfig {
+  /** Name used for reporting and to name the files of the call. */
+  ::std::string name;
+  /** Options passed to verifyta, separated by whitespace. */
+  ::std::string options;
+};
+typedef struct solverConfig SolverConfig;
+
+/**
+ * Outcome of a portfolio run (see solvePortfolio()).
+ */
+struct portfolioResult {
+  /** Position of the configuration that answered first, npos if none. */
+  ::std::size_t winner;
+  /**
+   * True iff the answer of the winner is that the query is satisfied and its
+   * trace is available.
+   */
+  bool satisfied;
+  /**
+   * Time each configuration ran until it finished or was killed, in the
+   * order of the configurations.
+   */
+  ::std::vector<timedelta> timings;
+  static constexpr ::std::size_t npos = static_cast<::std::size_t>(-1);
+};
+typedef struct portfolioResult PortfolioResult;
+
+/**
+ * Default portfolio: the fastest trace (as used by solve()) raced against
+ * arbitrary traces from breadth-first, depth-first and random depth-first
+ * search, the latter also with aggressive state space reduction.
+ *
+ * @return portfolio configurations
+ */
+::std::vector<SolverConfig> defaultPortfolio();
+
+/**
+ * Call verifyta with several configurations concurrently on the same system
+ * and query, the first configuration that answers the query wins and the
+ * others are killed. If the query is satisfied, the trace of the winner is
+ * made readable by the tracer, just like solve() does.
+ *
+ * The chosen configuration and the timings of all configurations are
+ * printed.
+ *
+ * @param sys automata system to solve the query for
+ * @param file_name name of xml system file without .xml, use
+ *                  SolverSession::path() to avoid collisions with
+ *                  concurrent calls
+ * @param query_str query string suitable for uppaal
+ * @param configs configurations to race
+ * @return winner and timings of the configurations
+ */
+PortfolioResult
+solvePortfolio(const AutomataSystem &sys, ::std::string file_name,
+               ::std::string query_str = QUERY_STR,
+               const ::std::vector<SolverConfig> &configs = defaultPortfolio());
 } // end namespace uppaalcalls
 } // end namespace taptenc
@@ -40,21 +40,14 @@ taptenc::iUnitNormalFromPoints(const ::std::pair<int, int> &a,
   return normal;
 }
 
-::std::unique_ptr<ClockConstraint>
-taptenc::addConstraint(const ClockConstraint &old_con,
-                       const ClockConstraint &to_add) {
-  if (old_con.type == CCType::TRUE) {
-    return to_add.createCopy();
-  }
-  if (to_add.type == CCType::TRUE) {
-    return old_con.createCopy();
-  }
-  return ConjunctionCC(old_con, to_add).createCopy();
+FlatCCPtr taptenc::addConstraint(const ClockConstraint &old_con,
+                                 const ClockConstraint &to_add) {
+  return FlatCC::conjunction(old_con, to_add);
 }
 update_t taptenc::addUpdate(const update_t &old_con, const update_t &to_add) {
   update_t res(old_con);
-  res.insert(to_add.begin(), to_add.end());
-  return {res};
+  res |= to_add;
+  return res;
 }
 
 std::string taptenc::trim(const ::std::string &str,
@@ -113,10 +113,11 @@ float fDotProduct(const ::std::pair<float, float> &a,
  *
  * @param old_con constraint1
  * @param to_add constraint2
- * @return conjunction of constraint1 and constraint2
+ * @return shared conjunction of constraint1 and constraint2 from the
+ *         constraint store (see FlatCC)
  */
-::std::unique_ptr<ClockConstraint> addConstraint(const ClockConstraint &old_con,
-                                                 const ClockConstraint &to_add);
+FlatCCPtr addConstraint(const ClockConstraint &old_con,
+                        const ClockConstraint &to_add);
 
 /**
  * Concatenates two clock updates.
@@ -0,0 +1,237 @@
+/** \file
+ * Checks that updating a direct encoding for a changed plan yields the same
+ * automaton as encoding the changed plan from scratch.
+ *
+ * Exits with a non-zero status if an incremental encoding differs from the
+ * full encoding of the same plan.
+ */
+
+#include "constants.h"
+#include "constraints/constraints.h"
+#include "encoder/direct_encoder.h"
+#include "platform_model_generator.h"
+#include "transformation.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace taptenc;
+
+namespace {
+
+/**
+ * Appends the start and end actions of a plan step.
+ *
+ * @param plan plan to extend
+ * @param step name of the step, e.g. "goto" for startgoto and endgoto
+ * @param args arguments of the step
+ * @param duration duration of the step
+ * @param abs_time absolute time bounds of the step start, set to the time
+ *                 bounds after the step
+ */
+void addStep(std::vector<PlanAction> &plan, const std::string &step,
+             const std::vector<std::string> &args, const Bounds &duration,
+             Bounds &abs_time) {
+  Bounds end_bounds(0, 30);
+  plan.push_back(PlanAction(ActionName("start" + step, args), abs_time,
+                            duration));
+  abs_time = Bounds(safeAddition(abs_time.lower_bound, duration.lower_bound),
+                    safeAddition(abs_time.upper_bound, duration.upper_bound));
+  plan.push_back(
+      PlanAction(ActionName("end" + step, args), abs_time, end_bounds));
+  abs_time = Bounds(safeAddition(abs_time.lower_bound, end_bounds.lower_bound),
+                    safeAddition(abs_time.upper_bound, end_bounds.upper_bound));
+}
+
+/** Steps given as name and arguments, goto steps take longer than grasps. */
+typedef std::vector<std::pair<std::string, std::vector<std::string>>> Steps;
+
+std::vector<PlanAction> createPlan(const Steps &steps) {
+  std::vector<PlanAction> plan;
+  Bounds abs_time(0, 30);
+  plan.push_back(PlanAction(ActionName("startplan", {"arg0", "arg1"}),
+                            abs_time, Bounds(0, 0)));
+  for (const auto &step : steps) {
+    addStep(plan, step.first, step.second,
+            step.first == "goto" ? Bounds(30, 45) : Bounds(15, 20), abs_time);
+  }
+  return plan;
+}
+
+/**
+ * Order independent representation of the first automaton of a system.
+ *
+ * @param s automata system
+ * @return sorted string representations of all states and transitions
+ */
+std::vector<std::string> canonical(const AutomataSystem &s) {
+  std::vector<std::string> res;
+  const Automaton &ta = s.instances[0].first;
+  for (const auto &st : ta.states) {
+    res.push_back("state " + st.id.str() + " " + st.inv->toString() + " " +
+                  std::to_string(st.urgent) + std::to_string(st.initial));
+  }
+  for (const auto &trans : ta.transitions) {
+    res.push_back("trans " + trans.source_id.str() + " " +
+                  trans.dest_id.str() + " " + trans.guard->toString() + " " +
+                  trans.updateToString() + " " + trans.sync);
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+/**
+ * Compares the update of an encoding of \a prev_plan to the full encoding of
+ * \a plan for the given platform.
+ *
+ * @param name name of the test case used in the output
+ * @param platform platform TA
+ * @param constraints constraints of \a platform
+ * @param prev_plan previously encoded plan
+ * @param plan changed plan
+ * @param reused incremented by the number of reused timelines
+ * @return true iff both encodings are equal
+ */
+bool checkUpdate(const std::string &name, const Automaton &platform,
+                 const std::vector<std::unique_ptr<EncICInfo>> &constraints,
+                 const std::vector<PlanAction> &prev_plan,
+                 const std::vector<PlanAction> &plan, size_t &reused) {
+  AutomataSystem prev_sys;
+  prev_sys.instances.push_back(std::make_pair(platform, ""));
+  DirectEncoder prev_enc =
+      transformation::createDirectEncoding(prev_sys, prev_plan, constraints);
+  reused += prev_enc.reusableTimelines(plan);
+  AutomataSystem full_sys;
+  full_sys.instances.push_back(std::make_pair(platform, ""));
+  DirectEncoder full_enc =
+      transformation::createDirectEncoding(full_sys, plan, constraints);
+  AutomataSystem inc_sys;
+  inc_sys.instances.push_back(std::make_pair(platform, ""));
+  DirectEncoder inc_enc = transformation::updateDirectEncoding(
+      prev_enc, inc_sys, plan, constraints);
+  std::vector<std::string> full =
+      canonical(full_enc.createFinalSystem(full_sys));
+  std::vector<std::string> inc = canonical(inc_enc.createFinalSystem(inc_sys));
+  if (full == inc) {
+    return true;
+  }
+  std::vector<std::string> only_full, only_inc;
+  std::set_difference(full.begin(), full.end(), inc.begin(), inc.end(),
+                      std::back_inserter(only_full));
+  std::set_difference(inc.begin(), inc.end(), full.begin(), full.end(),
+                      std::back_inserter(only_inc));
+  std::cout << "FAIL " << name << ": incremental encoding differs from full "
+            << "encoding" << std::endl;
+  for (const auto &line : only_full) {
+    std::cout << "  only in full: " << line << std::endl;
+  }
+  for (const auto &line : only_inc) {
+    std::cout << "  only in incremental: " << line << std::endl;
+  }
+  return false;
+}
+
+/**
+ * Creates two until chains for a communication TA (see
+ * benchmarkgenerator::generateCommTA()) that, unlike the benchmark
+ * constraints, do not cover the whole plan.
+ *
+ * Hence encodings of a plan prefix keep activations of both chains, which
+ * are followed by further activations of the first chain in the changed
+ * suffix.
+ *
+ * @param comm_ta communication TA of machine cs1
+ * @return constraints preparing cs1 between put and pick and keeping it idle
+ *         while driving towards it
+ */
+std::vector<std::unique_ptr<EncICInfo>>
+createChainConstraints(const Automaton &comm_ta) {
+  std::string obj = std::string() + constants::VAR_PREFIX + "o";
+  std::string from = std::string() + constants::VAR_PREFIX + "f";
+  Bounds full_bounds(0, std::numeric_limits<int>::max());
+  std::vector<std::unique_ptr<EncICInfo>> res;
+  res.emplace_back(std::make_unique<ChainInfo>(
+      "prep", ICType::UntilChain,
+      std::vector<ActionName>({ActionName("endput", {obj, "cs1"})}),
+      std::vector<TargetSpecs>{
+          TargetSpecs(full_bounds, {comm_ta.states[0], comm_ta.states[1]}),
+          TargetSpecs(full_bounds, {comm_ta.states[2]})},
+      std::vector<ActionName>({ActionName("startpick", {obj, "cs1"})})));
+  res.emplace_back(std::make_unique<ChainInfo>(
+      "idle", ICType::UntilChain,
+      std::vector<ActionName>({ActionName("startgoto", {from, "cs1"})}),
+      std::vector<TargetSpecs>{TargetSpecs(full_bounds, {comm_ta.states[0]})},
+      std::vector<ActionName>({ActionName("endgoto", {from, "cs1"})})));
+  return res;
+}
+
+} // end anonymous namespace
+
+int main() {
+  // the second visit of cs1 activates the constraints of the cs1
+  // communication TA again, after other activations were already encoded
+  Steps prefix = {{"goto", {"start", "cs1"}},
+                  {"put", {"wp0", "cs1"}},
+                  {"pick", {"wp0", "cs1"}},
+                  {"goto", {"cs1", "bs"}},
+                  {"pick", {"wp1", "bs"}}};
+  Steps extended = prefix;
+  extended.insert(extended.end(), {{"goto", {"bs", "cs1"}},
+                                   {"put", {"wp1", "cs1"}},
+                                   {"pick", {"wp1", "cs1"}},
+                                   {"goto", {"cs1", "ds"}},
+                                   {"put", {"wp1", "ds"}}});
+  Steps replanned(prefix.begin(), prefix.end() - 2);
+  replanned.insert(replanned.end(), {{"goto", {"cs1", "rs1"}},
+                                     {"put", {"wp0", "rs1"}},
+                                     {"pick", {"wp0", "rs1"}},
+                                     {"goto", {"rs1", "cs1"}},
+                                     {"put", {"wp0", "cs1"}},
+                                     {"pick", {"wp0", "cs1"}}});
+  std::vector<PlanAction> prev_plan = createPlan(prefix);
+  std::vector<std::pair<std::string, std::vector<PlanAction>>> cases = {
+      {"extended", createPlan(extended)}, {"replanned", createPlan(replanned)}};
+
+  std::vector<std::string> names = {"perception", "calibration", "comm cs1",
+                                    "comm rs1", "chains cs1"};
+  std::vector<Automaton> platforms = {
+      benchmarkgenerator::generatePerceptionTA(),
+      benchmarkgenerator::generateCalibrationTA(),
+      benchmarkgenerator::generateCommTA("cs1"),
+      benchmarkgenerator::generateCommTA("rs1"),
+      benchmarkgenerator::generateCommTA("cs1")};
+  transformation::Constraints constraints;
+  constraints.emplace_back(
+      benchmarkgenerator::generatePerceptionConstraints(platforms[0]));
+  constraints.emplace_back(
+      benchmarkgenerator::generateCalibrationConstraints(platforms[1]));
+  constraints.emplace_back(
+      benchmarkgenerator::generateCommConstraints(platforms[2], "cs1"));
+  constraints.emplace_back(
+      benchmarkgenerator::generateCommConstraints(platforms[3], "rs1"));
+  constraints.emplace_back(createChainConstraints(platforms[4]));
+
+  bool success = true;
+  for (const auto &test_case : cases) {
+    for (size_t i = 0; i < platforms.size(); i++) {
+      size_t reused = 0;
+      success &= checkUpdate(test_case.first + " " + names[i], platforms[i],
+                             constraints[i], prev_plan, test_case.second,
+                             reused);
+      if (i + 1 == platforms.size() && reused == 0) {
+        std::cout << "FAIL " << test_case.first << " " << names[i]
+                  << ": no timeline was reused" << std::endl;
+        success = false;
+      }
+    }
+  }
+  if (success) {
+    std::cout << "incremental encoding test passed" << std::endl;
+  }
+  return success ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/** \file
+ * Checks the results of the in-process reachability checking on small
+ * automata, including the systems the solver reports as unsupported.
+ *
+ * Exits with a non-zero status if a query yields an unexpected result.
+ */
+
+#include "constants.h"
+#include "constraints/constraints.h"
+#include "solver/zone_solver.h"
+#include "timed-automata/timed_automata.h"
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace taptenc;
+
+namespace {
+
+/** Query of all test cases. */
+const std::string QUERY = "E<> sys_direct.AqueryA";
+
+/**
+ * Creates a system consisting of a single automaton that has a clock x and
+ * the global clock.
+ *
+ * @param states states of the automaton
+ * @param transitions transitions of the automaton
+ * @param x receives the clock x
+ * @param glob receives the global clock
+ * @return system containing the automaton "direct"
+ */
+AutomataSystem createSystem(const std::vector<State> &states,
+                            const std::vector<Transition> &transitions,
+                            const std::shared_ptr<Clock> &x,
+                            const std::shared_ptr<Clock> &glob) {
+  AutomataSystem res;
+  Automaton ta(states, transitions, "direct", false);
+  ta.clocks.insert({x, glob});
+  res.instances.push_back(std::make_pair(ta, ""));
+  return res;
+}
+
+std::string resultName(ReachabilityResult res) {
+  switch (res) {
+  case ReachabilityResult::Reachable:
+    return "reachable";
+  case ReachabilityResult::Unreachable:
+    return "unreachable";
+  default:
+    return "unsupported";
+  }
+}
+
+/**
+ * Solves the query of a test case and compares the result.
+ *
+ * @param name name of the test case used in the output
+ * @param s system to solve the query for
+ * @param expected expected result
+ * @param trace receives the trace if the query is satisfied
+ * @param reason expected prefix of the reason if \a expected is Unsupported
+ * @return true iff the result is as expected
+ */
+bool checkResult(const std::string &name, const AutomataSystem &s,
+                 ReachabilityResult expected, SymbolicTrace &trace,
+                 const std::string &reason = "") {
+  ZoneSolver solver(s, QUERY);
+  ReachabilityResult res = solver.solve(trace);
+  if (res != expected) {
+    std::cout << "FAIL " << name << ": expected " << resultName(expected)
+              << ", but the query is " << resultName(res) << " "
+              << solver.unsupportedReason() << std::endl;
+    return false;
+  }
+  if (res == ReachabilityResult::Unsupported &&
+      solver.unsupportedReason().compare(0, reason.size(), reason) != 0) {
+    std::cout << "FAIL " << name << ": expected reason " << reason
+              << ", but got " << solver.unsupportedReason() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool checkResult(const std::string &name, const AutomataSystem &s,
+                 ReachabilityResult expected,
+                 const std::string &reason = "") {
+  SymbolicTrace trace;
+  return checkResult(name, s, expected, trace, reason);
+}
+
+/**
+ * The direct transition to the queried state is enabled later than the
+ * detour over another state, the trace has to take the detour.
+ */
+bool checkFastestTrace(const std::shared_ptr<Clock> &x,
+                       const std::shared_ptr<Clock> &glob) {
+  AutomataSystem s = createSystem(
+      {State("a", TrueCC(), false, true), State("c", TrueCC()),
+       State("AqueryA", TrueCC())},
+      {Transition("a", "AqueryA", "", ComparisonCC(glob, ComparisonOp::GTE, 10),
+                  {}, ""),
+       Transition("a", "c", "", ComparisonCC(x, ComparisonOp::GTE, 2), {x},
+                  ""),
+       Transition("c", "AqueryA", "", ComparisonCC(x, ComparisonOp::GTE, 2),
+                  {}, "")},
+      x, glob);
+  SymbolicTrace trace;
+  if (!checkResult("fastest trace", s, ReachabilityResult::Reachable, trace)) {
+    return false;
+  }
+  std::vector<std::string> path;
+  for (const auto &st : trace.states) {
+    path.push_back(st.state_id);
+  }
+  if (path != std::vector<std::string>({"a", "c", "AqueryA"})) {
+    std::cout << "FAIL fastest trace: expected path a c AqueryA, but got";
+    for (const auto &id : path) {
+      std::cout << " " << id;
+    }
+    std::cout << std::endl;
+    return false;
+  }
+  // lower bound of the global clock, stored as t(0) - glob <= -4
+  auto earliest = trace.states.back().zone.find(
+      std::make_pair(std::string("t(0)"), glob->id.str()));
+  if (earliest == trace.states.back().zone.end() ||
+      earliest->second != dbm_entry_t(-4, false)) {
+    std::cout << "FAIL fastest trace: the queried state is not reached at "
+              << "time 4" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // end anonymous namespace
+
+int main() {
+  auto x = std::make_shared<Clock>("x");
+  auto glob = std::make_shared<Clock>(constants::GLOBAL_CLOCK);
+  bool success = checkFastestTrace(x, glob);
+
+  // the invariant ends the stay in a before the guard is enabled
+  success &= checkResult(
+      "invariant",
+      createSystem({State("a", ComparisonCC(x, ComparisonOp::LTE, 5), false,
+                          true),
+                    State("AqueryA", TrueCC())},
+                   {Transition("a", "AqueryA", "",
+                               ComparisonCC(x, ComparisonOp::GTE, 10), {},
+                               "")},
+                   x, glob),
+      ReachabilityResult::Unreachable);
+
+  // no time passes in urgent states
+  std::vector<Transition> delayed = {Transition(
+      "a", "AqueryA", "", ComparisonCC(x, ComparisonOp::GTE, 1), {}, "")};
+  success &= checkResult(
+      "urgent",
+      createSystem({State("a", TrueCC(), true, true),
+                    State("AqueryA", TrueCC())},
+                   delayed, x, glob),
+      ReachabilityResult::Unreachable);
+  success &= checkResult(
+      "not urgent",
+      createSystem({State("a", TrueCC(), false, true),
+                    State("AqueryA", TrueCC())},
+                   delayed, x, glob),
+      ReachabilityResult::Reachable);
+
+  // systems that have to be solved by verifyta instead
+  std::vector<State> states = {State("a", TrueCC(), false, true),
+                               State("AqueryA", TrueCC())};
+  AutomataSystem several = createSystem(states, {}, x, glob);
+  several.instances.push_back(several.instances[0]);
+  success &= checkResult("several automata", several,
+                         ReachabilityResult::Unsupported,
+                         "only systems with a single automaton");
+  success &= checkResult(
+      "inequality",
+      createSystem(states,
+                   {Transition("a", "AqueryA", "",
+                               ComparisonCC(x, ComparisonOp::NEQ, 1), {}, "")},
+                   x, glob),
+      ReachabilityResult::Unsupported, "unsupported constraint");
+  success &= checkResult(
+      "undeclared channel",
+      createSystem(states,
+                   {Transition("a", "AqueryA", "", TrueCC(), {}, "go")}, x,
+                   glob),
+      ReachabilityResult::Unsupported, "undeclared channel go");
+  success &= checkResult(
+      "global clock reset",
+      createSystem(states,
+                   {Transition("a", "AqueryA", "", TrueCC(), {glob}, "")}, x,
+                   glob),
+      ReachabilityResult::Unsupported, "reset of the global clock");
+  success &= checkResult(
+      "no initial state",
+      createSystem({State("a", TrueCC()), State("AqueryA", TrueCC())},
+                   {Transition("a", "AqueryA", "", TrueCC(), {}, "")}, x,
+                   glob),
+      ReachabilityResult::Unsupported, "automaton has no initial state");
+
+  if (success) {
+    std::cout << "zone solver test passed" << std::endl;
+  }
+  return success ? 0 : 1;
+}